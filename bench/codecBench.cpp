@@ -0,0 +1,272 @@
+/**
+ * microbenchmarks of the packet codecs and the register layouts
+ *
+ * usage: inspexel-bench [--filter <regex>] [--min_time_ms <ms>]
+ * prints one JSON document:
+ *   {"version":1,"benchmarks":[{"name":"...","iterations":...,"ns_per_op":...,"bytes_per_second":...,"allocs_per_op":...},...]}
+ * bytes_per_second refers to the packet bytes produced or consumed by one operation (0 if that does not apply)
+ */
+#include "usb2dynamixel/Layout.h"
+#include "usb2dynamixel/MotorMetaInfo.h"
+#include "usb2dynamixel/ProtocolV1.h"
+#include "usb2dynamixel/ProtocolV2.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <regex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+std::atomic<uint64_t> allocations {0};
+}
+
+// every allocation of the process is counted to report allocations per operation
+void* operator new(std::size_t size) {
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	if (auto ptr = std::malloc(size ? size : 1)) {
+		return ptr;
+	}
+	throw std::bad_alloc{};
+}
+void* operator new[](std::size_t size) {
+	return operator new(size);
+}
+void operator delete(void* ptr) noexcept {
+	std::free(ptr);
+}
+void operator delete[](void* ptr) noexcept {
+	std::free(ptr);
+}
+void operator delete(void* ptr, std::size_t) noexcept {
+	std::free(ptr);
+}
+void operator delete[](void* ptr, std::size_t) noexcept {
+	std::free(ptr);
+}
+
+namespace {
+
+using namespace dynamixel;
+
+template <typename T>
+void doNotOptimize(T const& value) {
+	asm volatile("" : : "r,m"(value) : "memory");
+}
+
+struct Result {
+	std::string name;
+	uint64_t    iterations;
+	double      nsPerOp;
+	double      bytesPerSecond;
+	double      allocsPerOp;
+};
+
+struct Runner {
+	std::regex                filter {".*"};
+	std::chrono::nanoseconds  minTime {std::chrono::milliseconds{200}};
+	std::vector<Result>       results;
+
+	// runs op with doubling iteration counts until one run takes at least minTime
+	template <typename Op>
+	void run(std::string const& name, std::size_t bytesPerOp, Op&& op) {
+		if (not std::regex_search(name, filter)) {
+			return;
+		}
+		op(); // warm up caches and static data
+		for (uint64_t iterations{1};; iterations *= 2) {
+			auto allocationsBefore = allocations.load(std::memory_order_relaxed);
+			auto start = std::chrono::steady_clock::now();
+			for (uint64_t i{0}; i < iterations; ++i) {
+				op();
+			}
+			auto elapsed = std::chrono::steady_clock::now() - start;
+			auto allocated = allocations.load(std::memory_order_relaxed) - allocationsBefore;
+			if (elapsed >= minTime or iterations >= (uint64_t{1} << 32)) {
+				double ns = std::chrono::duration<double, std::nano>{elapsed}.count() / iterations;
+				results.push_back({name, iterations, ns, bytesPerOp * 1e9 / ns, double(allocated) / iterations});
+				return;
+			}
+		}
+	}
+
+	void print(std::ostream& os) const {
+		os << "{\"version\":1,\"benchmarks\":[";
+		for (std::size_t i{0}; i < results.size(); ++i) {
+			auto const& r = results[i];
+			os << (i ? "," : "") << "\n  {\"name\":\"" << r.name << "\",\"iterations\":" << r.iterations
+			   << ",\"ns_per_op\":" << r.nsPerOp << ",\"bytes_per_second\":" << r.bytesPerSecond
+			   << ",\"allocs_per_op\":" << r.allocsPerOp << "}";
+		}
+		os << "\n]}\n";
+	}
+};
+
+auto makeParameter(std::size_t size, uint8_t seed) -> Parameter {
+	Parameter p(size);
+	for (std::size_t i{0}; i < size; ++i) {
+		p[i] = std::byte(uint8_t(seed + i * 37));
+	}
+	return p;
+}
+
+// a payload that needs escaping every 16 bytes (0xff 0xff 0xfd)
+auto makeEscapable(std::size_t size) -> Parameter {
+	auto p = makeParameter(size, 1);
+	for (std::size_t i{0}; i + 3 <= size; i += 16) {
+		p[i] = p[i+1] = std::byte{0xff};
+		p[i+2] = std::byte{0xfd};
+	}
+	return p;
+}
+
+auto makeBulkRead(std::size_t motors) -> std::vector<std::tuple<MotorID, int, size_t>> {
+	std::vector<std::tuple<MotorID, int, size_t>> request;
+	for (std::size_t i{0}; i < motors; ++i) {
+		request.emplace_back(MotorID(i + 1), 36, 8);
+	}
+	return request;
+}
+
+// feeds status packets through a non blocking pipe, just like a serial port delivers them
+struct PipeFeed {
+	simplyfile::SerialPort      port;
+	simplyfile::FileDescriptor  writeEnd;
+
+	PipeFeed() {
+		int fds[2];
+		if (0 != ::pipe2(fds, O_NONBLOCK)) {
+			throw std::runtime_error("cannot create a pipe");
+		}
+		static_cast<simplyfile::FileDescriptor&>(port) = fds[0];
+		writeEnd = fds[1];
+	}
+
+	void feed(Parameter const& packet) {
+		if (::write(writeEnd, packet.data(), packet.size()) != ssize_t(packet.size())) {
+			throw std::runtime_error("cannot write to the pipe");
+		}
+	}
+};
+
+void benchProtocol(Runner& runner, std::string const& prefix, ProtocolBase const& protocol) {
+	auto readRequest = protocol.convertAddress(36);
+	for (auto b : protocol.convertLength(8)) {
+		readRequest.push_back(b);
+	}
+	auto readPacket = protocol.createPacket(7, Instruction::READ, readRequest);
+	runner.run(prefix + "/createPacket/read", readPacket.size(), [&] {
+		doNotOptimize(protocol.createPacket(7, Instruction::READ, readRequest));
+	});
+
+	auto syncWrite = makeParameter(2 + 16 * 5, 3);
+	auto syncWritePacket = protocol.createPacket(BroadcastID, Instruction::SYNC_WRITE, syncWrite);
+	runner.run(prefix + "/createPacket/sync_write_16", syncWritePacket.size(), [&] {
+		doNotOptimize(protocol.createPacket(BroadcastID, Instruction::SYNC_WRITE, syncWrite));
+	});
+
+	for (std::size_t motors : {1, 16}) {
+		auto request = makeBulkRead(motors);
+		auto size = protocol.buildBulkReadPackage(request).size();
+		runner.run(prefix + "/buildBulkReadPackage/" + std::to_string(motors), size, [&] {
+			doNotOptimize(protocol.buildBulkReadPackage(request));
+		});
+	}
+
+	// a status packet of motor 7 carrying 8 bytes, the error byte takes the place of the instruction
+	auto status = prefix == "v1" ? protocol.createPacket(7, Instruction(0), makeParameter(8, 5))
+	                             : protocol.createPacket(7, Instruction::STATUS, [] { auto p = makeParameter(9, 5); p[0] = std::byte{0}; return p; }());
+	auto feed = PipeFeed{};
+	runner.run(prefix + "/readPacket/8", status.size(), [&] {
+		feed.feed(status);
+		doNotOptimize(protocol.readPacket(std::chrono::seconds{1}, 7, 8, feed.port));
+	});
+}
+
+void benchChecksums(Runner& runner) {
+	auto v1Packet = ProtocolV1{}.createPacket(7, Instruction::WRITE, makeParameter(32, 9));
+	v1Packet.pop_back();
+	runner.run("v1/calculateChecksum/" + std::to_string(v1Packet.size()), v1Packet.size(), [&] {
+		doNotOptimize(detail::v1::calculateChecksum(v1Packet));
+	});
+	auto v1Complete = ProtocolV1{}.createPacket(7, Instruction::WRITE, makeParameter(32, 9));
+	runner.run("v1/validatePacket/" + std::to_string(v1Complete.size()), v1Complete.size(), [&] {
+		doNotOptimize(detail::v1::validatePacket(v1Complete));
+	});
+
+	for (std::size_t size : {16, 256}) {
+		auto data = makeParameter(size, 11);
+		runner.run("v2/calculateChecksum/" + std::to_string(size), size, [&] {
+			doNotOptimize(detail::v2::calculateChecksum(data.begin(), data.end()));
+		});
+	}
+
+	auto plain   = makeParameter(256, 13);
+	auto special = makeEscapable(256);
+	auto escaped = detail::v2::addEscapes(special.begin(), special.end());
+	runner.run("v2/addEscapes/256_plain", plain.size(), [&] {
+		doNotOptimize(detail::v2::addEscapes(plain.begin(), plain.end()));
+	});
+	runner.run("v2/addEscapes/256_escaped", special.size(), [&] {
+		doNotOptimize(detail::v2::addEscapes(special.begin(), special.end()));
+	});
+	runner.run("v2/removeEscapes/256_escaped", escaped.size(), [&] {
+		doNotOptimize(detail::v2::removeEscapes(escaped.begin(), escaped.end()));
+	});
+}
+
+void benchLayouts(Runner& runner) {
+	auto buffer = makeParameter(sizeof(mx_v2::FullLayout), 17);
+	runner.run("layout/construct/mx_v2", buffer.size(), [&] {
+		doNotOptimize(mx_v2::FullLayout(buffer));
+	});
+	auto layout = mx_v2::FullLayout(buffer);
+	runner.run("layout/visit/mx_v2", buffer.size(), [&] {
+		int64_t sum {0};
+		visit([&](auto, auto const& value) { sum += int64_t(value); }, layout);
+		doNotOptimize(sum);
+	});
+
+	auto proBuffer = makeParameter(sizeof(pro::FullLayout), 19);
+	runner.run("layout/construct/pro", proBuffer.size(), [&] {
+		doNotOptimize(pro::FullLayout(proBuffer));
+	});
+
+	runner.run("meta/getMotorInfo/number", 0, [&] {
+		doNotOptimize(meta::getMotorInfo(uint16_t(1020)));
+	});
+	runner.run("meta/getMotorInfo/name", 0, [&] {
+		doNotOptimize(meta::getMotorInfo(std::string{"XM430-W350-T"}));
+	});
+}
+
+}
+
+int main(int argc, char** argv) {
+	Runner runner;
+	for (int i{1}; i + 1 < argc; i += 2) {
+		auto arg = std::string{argv[i]};
+		if (arg == "--filter") {
+			runner.filter = std::regex{argv[i+1]};
+		} else if (arg == "--min_time_ms") {
+			runner.minTime = std::chrono::milliseconds{std::stoi(argv[i+1])};
+		} else {
+			std::cerr << "unknown argument " << arg << "\n";
+			return 1;
+		}
+	}
+
+	benchProtocol(runner, "v1", ProtocolV1{});
+	benchProtocol(runner, "v2", ProtocolV2{});
+	benchChecksums(runner);
+	benchLayouts(runner);
+	runner.print(std::cout);
+	return 0;
+}
@@ -0,0 +1,238 @@
+#include "Trajectory.h"
+
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace trajectory {
+namespace {
+
+constexpr char     Magic[4] = {'I', 'X', 'T', 'R'};
+constexpr uint32_t Version  = 1;
+
+auto rowSize(std::size_t channelCount) -> std::size_t {
+	return (sizeof(int64_t) + channelCount * sizeof(int32_t) + 7) / 8 * 8;
+}
+
+auto splitCSV(std::string const& line) -> std::vector<std::string> {
+	std::vector<std::string> fields;
+	std::stringstream ss{line};
+	std::string field;
+	while (std::getline(ss, field, ',')) {
+		fields.push_back(field);
+	}
+	return fields;
+}
+
+auto parseChannel(std::string const& field) -> Channel {
+	Channel channel{};
+	channel.baseRegister = DefaultRegister;
+	auto colon = field.find(':');
+	try {
+		channel.motor = dynamixel::MotorID(std::stoi(field.substr(0, colon)));
+		if (colon != std::string::npos) {
+			channel.baseRegister = std::stoi(field.substr(colon + 1), nullptr, 0);
+		}
+	} catch (std::exception const&) {
+		throw std::runtime_error("invalid trajectory channel \"" + field + "\", expected <id>[:<register>]");
+	}
+	return channel;
+}
+
+bool isBinary(std::string const& path) {
+	char magic[4] {};
+	std::ifstream file{path, std::ios::binary};
+	file.read(magic, sizeof(magic));
+	return file and std::memcmp(magic, Magic, sizeof(Magic)) == 0;
+}
+
+}
+
+void convertCSV(std::string const& csvPath, std::string const& binaryPath) {
+	std::ifstream csv{csvPath};
+	if (not csv) {
+		throw std::runtime_error("cannot open trajectory " + csvPath);
+	}
+	auto tmpPath = binaryPath + ".tmp";
+	std::ofstream out{tmpPath, std::ios::binary | std::ios::trunc};
+	if (not out) {
+		throw std::runtime_error("cannot write trajectory cache " + tmpPath);
+	}
+
+	std::vector<Channel> channels;
+	std::vector<std::byte> row;
+	FileHeader header{};
+	std::memcpy(header.magic, Magic, sizeof(Magic));
+	header.version = Version;
+
+	std::string line;
+	std::size_t lineNumber {0};
+	int64_t lastTime = std::numeric_limits<int64_t>::min();
+	while (std::getline(csv, line)) {
+		++lineNumber;
+		if (line.empty() or line[0] == '#') {
+			continue;
+		}
+		auto fields = splitCSV(line);
+		if (channels.empty()) {
+			if (fields.size() < 2) {
+				throw std::runtime_error(csvPath + ": the header needs a time column and at least one channel");
+			}
+			for (std::size_t i{1}; i < fields.size(); ++i) {
+				channels.push_back(parseChannel(fields[i]));
+			}
+			header.channelCount = channels.size();
+			out.write(reinterpret_cast<char const*>(&header), sizeof(header));
+			out.write(reinterpret_cast<char const*>(channels.data()), channels.size() * sizeof(Channel));
+			row.resize(rowSize(channels.size()));
+			continue;
+		}
+		if (fields.size() != channels.size() + 1) {
+			throw std::runtime_error(csvPath + ":" + std::to_string(lineNumber) + ": expected " + std::to_string(channels.size() + 1) + " values");
+		}
+		try {
+			int64_t time = std::llround(std::stod(fields[0]) * 1e9);
+			if (time < lastTime) {
+				throw std::runtime_error("time goes backwards");
+			}
+			lastTime = time;
+			std::memcpy(row.data(), &time, sizeof(time));
+			for (std::size_t c{0}; c < channels.size(); ++c) {
+				int32_t value = std::lround(std::stod(fields[c + 1]));
+				std::memcpy(row.data() + sizeof(int64_t) + c * sizeof(int32_t), &value, sizeof(value));
+			}
+		} catch (std::exception const& e) {
+			throw std::runtime_error(csvPath + ":" + std::to_string(lineNumber) + ": " + e.what());
+		}
+		out.write(reinterpret_cast<char const*>(row.data()), row.size());
+		++header.sampleCount;
+	}
+	if (channels.empty()) {
+		throw std::runtime_error(csvPath + " contains no trajectory");
+	}
+	out.seekp(0);
+	out.write(reinterpret_cast<char const*>(&header), sizeof(header));
+	out.close();
+	if (not out) {
+		throw std::runtime_error("cannot write trajectory cache " + tmpPath);
+	}
+	std::filesystem::rename(tmpPath, binaryPath);
+}
+
+MappedTrajectory::MappedTrajectory(std::string const& path, std::string cachePath) {
+	if (isBinary(path)) {
+		map(path);
+		return;
+	}
+	if (cachePath.empty()) {
+		cachePath = path + ".bin";
+	}
+	namespace fs = std::filesystem;
+	if (not fs::exists(cachePath) or fs::last_write_time(cachePath) < fs::last_write_time(path)) {
+		convertCSV(path, cachePath);
+	}
+	map(cachePath);
+}
+
+MappedTrajectory::~MappedTrajectory() {
+	if (mAddress) {
+		::munmap(mAddress, mSize);
+	}
+}
+
+void MappedTrajectory::map(std::string const& path) {
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		throw std::runtime_error("cannot open trajectory " + path);
+	}
+	struct stat st;
+	if (::fstat(fd, &st) != 0 or std::size_t(st.st_size) < sizeof(FileHeader)) {
+		::close(fd);
+		throw std::runtime_error(path + " is not a trajectory");
+	}
+	mSize    = st.st_size;
+	mAddress = ::mmap(nullptr, mSize, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (mAddress == MAP_FAILED) {
+		mAddress = nullptr;
+		throw std::runtime_error("cannot map trajectory " + path);
+	}
+	// playback reads the rows front to back exactly once
+	::madvise(mAddress, mSize, MADV_SEQUENTIAL);
+	try {
+		parse(path);
+	} catch (...) {
+		::munmap(mAddress, mSize);
+		mAddress = nullptr;
+		throw;
+	}
+}
+
+void MappedTrajectory::parse(std::string const& path) {
+	auto base = static_cast<std::byte const*>(mAddress);
+	FileHeader header;
+	std::memcpy(&header, base, sizeof(header));
+	if (std::memcmp(header.magic, Magic, sizeof(Magic)) != 0 or header.version != Version) {
+		throw std::runtime_error(path + " is not a trajectory of version " + std::to_string(Version));
+	}
+	mRowSize = rowSize(header.channelCount);
+	auto rowsOffset = sizeof(FileHeader) + header.channelCount * sizeof(Channel);
+	if (rowsOffset + header.sampleCount * mRowSize > mSize) {
+		throw std::runtime_error(path + " is truncated");
+	}
+	mChannels.resize(header.channelCount);
+	std::memcpy(mChannels.data(), base + sizeof(FileHeader), header.channelCount * sizeof(Channel));
+	mSampleCount = header.sampleCount;
+	mRows        = base + rowsOffset;
+}
+
+auto MappedTrajectory::duration() const -> std::chrono::nanoseconds {
+	if (mSampleCount == 0) {
+		return std::chrono::nanoseconds{0};
+	}
+	return time(mSampleCount - 1);
+}
+
+auto MappedTrajectory::time(std::size_t sample) const -> std::chrono::nanoseconds {
+	int64_t t;
+	std::memcpy(&t, mRows + sample * mRowSize, sizeof(t));
+	return std::chrono::nanoseconds{t};
+}
+
+auto MappedTrajectory::values(std::size_t sample) const -> int32_t const* {
+	return reinterpret_cast<int32_t const*>(mRows + sample * mRowSize + sizeof(int64_t));
+}
+
+void MappedTrajectory::interpolate(std::chrono::nanoseconds t, std::size_t& cursor, int32_t* out) const {
+	if (mSampleCount == 0) {
+		return;
+	}
+	// look ahead until the next sample lies in the future
+	while (cursor + 1 < mSampleCount and time(cursor + 1) <= t) {
+		++cursor;
+	}
+	auto channelCount = mChannels.size();
+	auto current = values(cursor);
+	if (cursor + 1 >= mSampleCount or t <= time(cursor)) {
+		std::memcpy(out, current, channelCount * sizeof(int32_t));
+		return;
+	}
+	auto next  = values(cursor + 1);
+	auto t0    = time(cursor);
+	auto span  = double((time(cursor + 1) - t0).count());
+	auto alpha = double((t - t0).count()) / span;
+	for (std::size_t c{0}; c < channelCount; ++c) {
+		out[c] = current[c] + int32_t(std::lround(alpha * (int64_t(next[c]) - current[c])));
+	}
+}
+
+}
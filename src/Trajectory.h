@@ -0,0 +1,75 @@
+#pragma once
+
+#include "usb2dynamixel/dynamixel.h"
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * a trajectory is a table of set-points: one row per point in time, one column (channel) per motor register
+ *
+ * trajectories are played from a memory mapped binary file:
+ *   FileHeader
+ *   channelCount * Channel
+ *   sampleCount * (int64_t time in ns, channelCount * int32_t values, padded to 8 bytes)
+ *
+ * CSV files are converted once into a binary cache next to them (<file>.bin) which is rebuilt whenever the CSV is newer.
+ * The first CSV line names the channels: "time,<id>[:<register>],..." (register defaults to the goal position),
+ * every further line holds the time in seconds followed by one value per channel. Lines starting with # are ignored.
+ */
+namespace trajectory {
+
+struct FileHeader {
+	char     magic[4];     // "IXTR"
+	uint32_t version;
+	uint32_t channelCount;
+	uint32_t padding;
+	uint64_t sampleCount;
+};
+
+struct Channel {
+	dynamixel::MotorID motor;
+	uint8_t            padding[3];
+	int32_t            baseRegister; // DefaultRegister: the goal position of the motor's layout
+};
+constexpr int32_t DefaultRegister = -1;
+
+struct MappedTrajectory {
+	// path is either a binary trajectory or a CSV file (which is converted into cachePath, default <path>.bin)
+	explicit MappedTrajectory(std::string const& path, std::string cachePath = "");
+	~MappedTrajectory();
+
+	MappedTrajectory(MappedTrajectory const&) = delete;
+	MappedTrajectory& operator=(MappedTrajectory const&) = delete;
+
+	[[nodiscard]] auto channels() const -> std::vector<Channel> const& { return mChannels; }
+	[[nodiscard]] auto sampleCount() const -> std::size_t { return mSampleCount; }
+	[[nodiscard]] auto duration() const -> std::chrono::nanoseconds;
+
+	[[nodiscard]] auto time(std::size_t sample) const -> std::chrono::nanoseconds;
+	[[nodiscard]] auto values(std::size_t sample) const -> int32_t const*;
+
+	/**
+	 * linear interpolation of all channels at time t into out (channelCount values)
+	 * cursor is the sample playback is currently at, it only moves forward so sequential playback touches every row once
+	 */
+	void interpolate(std::chrono::nanoseconds t, std::size_t& cursor, int32_t* out) const;
+
+private:
+	void map(std::string const& path);
+	void parse(std::string const& path);
+
+	void*                mAddress {nullptr};
+	std::size_t          mSize {0};
+	std::vector<Channel> mChannels;
+	std::size_t          mSampleCount {0};
+	std::size_t          mRowSize {0};
+	std::byte const*     mRows {nullptr};
+};
+
+// convert a CSV trajectory into the binary format, reads and writes line by line
+void convertCSV(std::string const& csvPath, std::string const& binaryPath);
+
+}
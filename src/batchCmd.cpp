@@ -0,0 +1,346 @@
+#include "usb2dynamixel/USB2Dynamixel.h"
+#include "usb2dynamixel/MotorMetaInfo.h"
+#include "globalOptions.h"
+
+#include "commonTasks.h"
+
+#include <charconv>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace {
+
+void runBatch();
+auto batchCmd       = sargp::Command{"batch", "execute commands read from stdin (or a file) over one open port, one command per line (see README)", runBatch};
+auto optFile        = batchCmd.Parameter<std::string>("", "file", "read commands from this file instead of stdin");
+auto optStopOnError = batchCmd.Flag("stop_on_error", "do not execute any further commands after a command failed");
+
+using namespace dynamixel;
+
+/*
+ * commands:
+ *   set_register <id> <register> <byte>...
+ *   get_register <id> <register> [<count>]
+ *   set_angle <id> <angle>
+ *   ping <id>
+ *   reboot <id>
+ *   flush (or an empty line): execute everything read so far before reading further
+ */
+struct Command {
+	std::size_t line {0};
+	std::string name;
+	MotorID     id {0};
+	int         baseRegister {0};
+	std::size_t count {0};
+	Parameter   data;   // set_register and set_angle (after resolving the goal position register)
+	int64_t     angle {0};
+};
+
+struct Result {
+	bool                     ok {true};
+	std::string              error;
+	std::string              transaction; // how the command was executed, e.g. "sync_write" if it was fused with others
+	std::optional<Parameter> data;
+};
+
+// reads the next word, returns false if there is none
+// the whole word has to be a number, "1.0abc" is no angle
+template<typename T>
+bool parseNumber(std::stringstream& ss, T& value) {
+	std::string word;
+	if (not (ss >> word)) {
+		return false;
+	}
+	auto [ptr, ec] = std::from_chars(word.data(), word.data() + word.size(), value);
+	if (ec != std::errc{} or ptr != word.data() + word.size()) {
+		throw std::runtime_error("\"" + word + "\" is not a valid number");
+	}
+	return true;
+}
+
+auto parseCommand(std::string const& text, std::size_t line) -> std::optional<Command> {
+	std::stringstream ss{text};
+	Command cmd;
+	cmd.line = line;
+	if (not (ss >> cmd.name) or cmd.name[0] == '#') {
+		return std::nullopt;
+	}
+	int id;
+	if (not parseNumber(ss, id) or id < 0 or id > 0xfe) {
+		throw std::runtime_error("expected a motor id");
+	}
+	cmd.id = MotorID(id);
+	if (cmd.name == "set_register") {
+		if (not parseNumber(ss, cmd.baseRegister)) {
+			throw std::runtime_error("expected a register");
+		}
+		int value;
+		while (parseNumber(ss, value)) {
+			if (value < 0 or value > 0xff) {
+				throw std::runtime_error("register values are bytes (0..255)");
+			}
+			cmd.data.push_back(std::byte(value));
+		}
+		if (cmd.data.empty()) {
+			throw std::runtime_error("expected values to write");
+		}
+	} else if (cmd.name == "get_register") {
+		if (not parseNumber(ss, cmd.baseRegister)) {
+			throw std::runtime_error("expected a register");
+		}
+		if (not parseNumber(ss, cmd.count)) {
+			cmd.count = 1;
+		}
+	} else if (cmd.name == "set_angle") {
+		if (not parseNumber(ss, cmd.angle)) {
+			throw std::runtime_error("expected an angle");
+		}
+	} else if (cmd.name != "ping" and cmd.name != "reboot") {
+		throw std::runtime_error("unknown command \"" + cmd.name + "\"");
+	}
+	if (std::string rest; ss >> rest and rest[0] != '#') {
+		throw std::runtime_error("unexpected \"" + rest + "\"");
+	}
+	return cmd;
+}
+
+auto jsonString(std::string const& s) -> std::string {
+	std::string out = "\"";
+	for (char c : s) {
+		switch (c) {
+			case '"':  out += "\\\""; break;
+			case '\\': out += "\\\\"; break;
+			case '\n': out += "\\n"; break;
+			default:   out += c;
+		}
+	}
+	return out + "\"";
+}
+
+// one JSON object per command and line
+void printResult(Command const& cmd, Result const& result) {
+	std::cout << "{\"line\":" << cmd.line << ",\"command\":" << jsonString(cmd.name) << ",\"id\":" << int(cmd.id) << ",\"ok\":" << (result.ok ? "true" : "false");
+	if (not result.transaction.empty()) {
+		std::cout << ",\"transaction\":" << jsonString(result.transaction);
+	}
+	if (result.data) {
+		std::cout << ",\"data\":[";
+		for (std::size_t i{0}; i < result.data->size(); ++i) {
+			std::cout << (i ? "," : "") << int((*result.data)[i]);
+		}
+		std::cout << "]";
+	}
+	if (not result.ok) {
+		std::cout << ",\"error\":" << jsonString(result.error);
+	}
+	std::cout << "}\n";
+}
+
+struct Executor {
+	USB2Dynamixel&                usb2dyn;
+	std::chrono::microseconds     timeout;
+	std::map<MotorID, LayoutType> layouts;
+
+	// set_angle becomes a write of the goal position register of the motor's layout
+	void resolveAngle(Command& cmd) {
+		auto iter = layouts.find(cmd.id);
+		if (iter == layouts.end()) {
+			auto [timeoutFlag, motorID, errorCode, layout] = usb2dyn.read<mx_v1::Register::MODEL_NUMBER, 2>(cmd.id, timeout);
+			if (timeoutFlag or motorID == MotorIDInvalid) {
+				throw std::runtime_error("motor does not answer");
+			}
+			auto modelPtr = meta::getMotorInfo(layout.model_number);
+			if (not modelPtr) {
+				throw std::runtime_error("unknown model " + std::to_string(layout.model_number));
+			}
+			iter = layouts.emplace(cmd.id, modelPtr->layout).first;
+		}
+		cmd.baseRegister = findRegister(iter->second, "Goal Position");
+		auto width = describeRegisters(iter->second, {cmd.baseRegister}).front().width;
+		cmd.data.resize(width);
+		for (std::size_t i{0}; i < width; ++i) {
+			cmd.data[i] = std::byte((cmd.angle >> (8*i)) & 0xff);
+		}
+	}
+
+	void executeSingle(Command const& cmd, Result& result) {
+		if (cmd.name == "set_register" or cmd.name == "set_angle") {
+			usb2dyn.write(cmd.id, cmd.baseRegister, cmd.data);
+			result.transaction = "write";
+		} else if (cmd.name == "get_register") {
+			auto [timeoutFlag, motorID, errorCode, rxBuf] = usb2dyn.read(cmd.id, cmd.baseRegister, cmd.count, timeout);
+			if (timeoutFlag or motorID == MotorIDInvalid) {
+				throw std::runtime_error("motor does not answer");
+			}
+			result.transaction = "read";
+			result.data = rxBuf;
+		} else if (cmd.name == "ping") {
+			result.transaction = "ping";
+			if (not usb2dyn.ping(cmd.id, timeout)) {
+				throw std::runtime_error("motor does not answer");
+			}
+		} else if (cmd.name == "reboot") {
+			usb2dyn.reboot(cmd.id);
+			result.transaction = "reboot";
+		}
+	}
+
+	/**
+	 * executes commands[first] and all following commands that can share a transaction with it
+	 * returns the index of the first command that was not executed
+	 * - writes of the same register and length to distinct motors become one sync write
+	 * - reads of distinct motors become one bulk read (protocol 2 only, not all protocol 1 motors support BULK_READ)
+	 */
+	auto executeGroup(std::vector<Command> const& commands, std::vector<Result>& results, std::size_t first) -> std::size_t {
+		auto const& head = commands[first];
+		bool isWrite = head.name == "set_register" or head.name == "set_angle";
+		bool isRead  = head.name == "get_register" and usb2dyn.getProtocol() == Protocol::V2;
+
+		std::set<MotorID> motors {head.id};
+		std::size_t last = first + 1;
+		for (; (isWrite or isRead) and last < commands.size() and results[last].ok; ++last) {
+			auto const& cmd = commands[last];
+			bool compatible = isWrite ? (cmd.name == "set_register" or cmd.name == "set_angle") and cmd.baseRegister == head.baseRegister and cmd.data.size() == head.data.size()
+			                          : cmd.name == "get_register";
+			if (not compatible or not motors.insert(cmd.id).second) {
+				break;
+			}
+		}
+
+		if (last - first == 1) {
+			executeSingle(head, results[first]);
+		} else if (isWrite) {
+			std::map<MotorID, Parameter> motorParams;
+			for (auto i{first}; i < last; ++i) {
+				motorParams[commands[i].id] = commands[i].data;
+			}
+			usb2dyn.sync_write(motorParams, head.baseRegister);
+			for (auto i{first}; i < last; ++i) {
+				results[i].transaction = "sync_write";
+			}
+		} else {
+			std::vector<std::tuple<MotorID, int, size_t>> request;
+			for (auto i{first}; i < last; ++i) {
+				request.emplace_back(commands[i].id, commands[i].baseRegister, commands[i].count);
+			}
+			auto response = usb2dyn.bulk_read(request, timeout);
+			for (auto i{first}; i < last; ++i) {
+				auto iter = std::find_if(begin(response), end(response), [&](auto const& r) { return std::get<0>(r) == commands[i].id; });
+				if (iter == end(response)) {
+					// the bulk read stops at the first motor that does not answer, ask the others one by one
+					try {
+						executeSingle(commands[i], results[i]);
+					} catch (std::exception const& e) {
+						results[i].ok    = false;
+						results[i].error = e.what();
+					}
+				} else {
+					results[i].transaction = "bulk_read";
+					results[i].data        = std::get<3>(*iter);
+				}
+			}
+		}
+		return last;
+	}
+};
+
+// executes one window of commands, the results of every group are printed as soon as it is done
+void executeWindow(Executor& executor, std::vector<Command>& commands, std::vector<Result>& results, bool& failed) {
+	for (std::size_t i{0}; i < commands.size();) {
+		auto next = i + 1;
+		if (failed and optStopOnError) {
+			results[i] = Result{false, "skipped after a previous error", {}, {}};
+		} else {
+			if (results[i].ok and commands[i].name == "set_angle") {
+				try {
+					executor.resolveAngle(commands[i]);
+				} catch (std::exception const& e) {
+					results[i] = Result{false, e.what(), {}, {}};
+				}
+			}
+			if (results[i].ok) {
+				// angles of the following commands must be resolved before they can be fused
+				for (auto j{i + 1}; j < commands.size() and (commands[j].name == "set_angle" or commands[j].name == "set_register") and results[j].ok; ++j) {
+					if (not commands[j].data.empty()) {
+						continue;
+					}
+					try {
+						executor.resolveAngle(commands[j]);
+					} catch (std::exception const& e) {
+						results[j] = Result{false, e.what(), {}, {}};
+						break;
+					}
+				}
+				try {
+					next = executor.executeGroup(commands, results, i);
+				} catch (std::exception const& e) {
+					results[i] = Result{false, e.what(), {}, {}};
+				}
+			}
+			for (auto j{i}; j < next; ++j) {
+				failed |= not results[j].ok;
+			}
+		}
+		for (auto j{i}; j < next; ++j) {
+			printResult(commands[j], results[j]);
+		}
+		std::cout << std::flush;
+		i = next;
+	}
+}
+
+void runBatch() {
+	// lets in_avail() see what is waiting in the pipe (the stdio synced buffer never reports anything)
+	std::ios::sync_with_stdio(false);
+
+	std::ifstream file;
+	if (not optFile->empty()) {
+		file.open(*optFile);
+		if (not file) {
+			throw std::runtime_error("cannot open " + *optFile);
+		}
+	}
+	std::istream& input = optFile->empty() ? std::cin : file;
+
+	auto usb2dyn  = USB2Dynamixel(*g_baudrate, *g_device, *g_protocolVersion);
+	auto executor = Executor{usb2dyn, std::chrono::microseconds{*g_timeout}, {}};
+
+	// commands are fused within a window: the lines that are already available, up to "flush" or an empty line
+	// a script that writes one command and waits for its result therefore gets it right away
+	bool failed = false;
+	bool eof    = false;
+	for (std::size_t line{0}; not eof;) {
+		std::vector<Command> commands;
+		std::vector<Result>  results;
+		std::string text;
+		while (true) {
+			if (not std::getline(input, text)) {
+				eof = true;
+				break;
+			}
+			++line;
+			if (std::string word; not (std::stringstream{text} >> word) or word == "flush") {
+				break;
+			}
+			try {
+				if (auto cmd = parseCommand(text, line)) {
+					commands.push_back(*cmd);
+					results.emplace_back();
+				}
+			} catch (std::exception const& e) {
+				Command invalid;
+				invalid.line = line;
+				invalid.name = "invalid";
+				commands.push_back(invalid);
+				results.push_back(Result{false, e.what(), {}, {}});
+			}
+			if (input.rdbuf()->in_avail() <= 0) {
+				break;
+			}
+		}
+		executeWindow(executor, commands, results, failed);
+	}
+}
+
+}
@@ -0,0 +1,276 @@
+#include "usb2dynamixel/USB2Dynamixel.h"
+#include "usb2dynamixel/LatencyHistogram.h"
+#include "usb2dynamixel/MotorMetaInfo.h"
+#include "usb2dynamixel/Simulator.h"
+#include "globalOptions.h"
+
+#include "commonTasks.h"
+
+#include <atomic>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <thread>
+
+namespace {
+
+void runBench();
+auto benchCmd        = sargp::Command{"bench", "measure round trip latencies and bus utilization of typical transactions", runBench};
+auto optWorkloads    = benchCmd.Parameter<std::vector<std::string>>({"ping", "read", "sync_read", "bulk_read", "sync_write", "mixed"}, "workloads", "workloads to run (ping, read, sync_read, bulk_read, sync_write, mixed)");
+auto optMotorCounts  = benchCmd.Parameter<std::vector<int>>({1, 4, 16}, "motor_counts", "numbers of motors addressed by one sync/bulk transaction");
+auto optPayloads     = benchCmd.Parameter<std::vector<int>>({2, 8, 32}, "payloads", "numbers of bytes read or written per motor");
+auto optTransactions = benchCmd.Parameter<int>(500, "transactions", "transactions per workload, motor count and payload");
+auto optIDs          = benchCmd.Parameter<std::set<int>>({}, "ids", "motors to use (default: all detected motors)");
+auto optReadRegister = benchCmd.Parameter<int>(0, "read_register", "first register of the windows that are read");
+auto optWriteReg     = benchCmd.Parameter<int>(-1, "write_register", "first register of the windows that are written, the current content is written back (default: goal position)");
+auto optSimulate     = benchCmd.Parameter<int>(0, "simulate", "run against this many simulated motors instead of --device");
+auto optSimModel     = benchCmd.Parameter<std::string>("", "sim_model", "model of the simulated motors (default: MX28 for protocol 1, XM430-W350 for protocol 2)");
+auto optSimDelay     = benchCmd.Parameter<int>(-1, "sim_return_delay_us", "return delay of the simulated motors (default: their Return Delay Time register)");
+auto optJSON         = benchCmd.Flag("json", "print the results as JSON");
+
+using namespace dynamixel;
+
+enum class Outcome { Ok, Timeout, Error };
+
+// bytes on the wire, ignoring byte stuffing
+struct Wire {
+	bool v2;
+	[[nodiscard]] auto instruction(std::size_t parameters) const -> std::size_t { return (v2 ? 10 : 6) + parameters; }
+	[[nodiscard]] auto status(std::size_t data) const -> std::size_t { return (v2 ? 11 : 6) + data; }
+	[[nodiscard]] auto addressWidth() const -> std::size_t { return v2 ? 2 : 1; }
+	[[nodiscard]] auto ping() const -> std::size_t { return instruction(0) + status(v2 ? 3 : 0); }
+};
+
+struct Config {
+	std::string          workload;
+	std::vector<MotorID> motors;
+	std::size_t          payload;
+};
+
+struct Result {
+	Config      config;
+	uint64_t    transactions;
+	uint64_t    timeouts;
+	uint64_t    errors;
+	std::chrono::nanoseconds p50, p90, p99, max, mean;
+	double      transactionsPerSecond;
+	double      busUtilization; // theoretical wire time of the successful transactions / elapsed time
+};
+
+struct Bench {
+	USB2Dynamixel const&      usb2dyn;
+	std::chrono::microseconds timeout;
+	Wire                      wire;
+	int                       baudrate;
+	int                       readRegister;
+	int                       writeRegister;
+
+	// the current content of the written windows, so writing does not change anything
+	auto readWriteWindows(Config const& config) const -> std::map<MotorID, Parameter> {
+		std::map<MotorID, Parameter> windows;
+		for (auto id : config.motors) {
+			auto [timeoutFlag, motorID, errorCode, rxBuf] = usb2dyn.read(id, writeRegister, config.payload, timeout);
+			if (timeoutFlag or motorID != id or rxBuf.size() != config.payload) {
+				throw std::runtime_error("cannot read registers " + std::to_string(writeRegister) + "+" + std::to_string(config.payload) + " of motor " + std::to_string(id));
+			}
+			windows[id] = rxBuf;
+		}
+		return windows;
+	}
+
+	auto run(Config const& config, int transactions) const -> Result {
+		bool needsWindows = config.workload == "sync_write" or config.workload == "mixed";
+		auto windows = needsWindows ? readWriteWindows(config) : std::map<MotorID, Parameter>{};
+		auto n       = config.motors.size();
+		// the sync read window as columns of single bytes
+		std::vector<TelemetryFrame::ColumnDescription> columns;
+		for (std::size_t i{0}; i < config.payload; ++i) {
+			columns.push_back({readRegister + int(i), 1, false});
+		}
+		auto frame = columns.empty() ? TelemetryFrame{} : TelemetryFrame{columns};
+		std::vector<std::tuple<MotorID, int, size_t>> bulkRequest;
+		for (auto id : config.motors) {
+			bulkRequest.emplace_back(id, readRegister, config.payload);
+		}
+		auto syncRead = [&](std::size_t& wireBytes) {
+			usb2dyn.sync_read(config.motors, frame, timeout);
+			// protocol 1 has no SYNC_READ, sync_read sends a BULK_READ instead
+			wireBytes += (wire.v2 ? wire.instruction(4 + n) : wire.instruction(1 + 3*n)) + n * wire.status(config.payload);
+			return frame.motors.size() == n ? Outcome::Ok : Outcome::Timeout;
+		};
+		auto syncWrite = [&](std::size_t& wireBytes) {
+			usb2dyn.sync_write(windows, writeRegister);
+			wireBytes += wire.instruction(2 * wire.addressWidth() + n * (1 + config.payload));
+		};
+
+		auto execute = [&](std::size_t iteration, std::size_t& wireBytes) -> Outcome {
+			auto id = config.motors[iteration % n];
+			if (config.workload == "ping") {
+				wireBytes += wire.ping();
+				return usb2dyn.ping(id, timeout) ? Outcome::Ok : Outcome::Timeout;
+			} else if (config.workload == "read") {
+				wireBytes += wire.instruction(2 * wire.addressWidth()) + wire.status(config.payload);
+				auto [timeoutFlag, motorID, errorCode, rxBuf] = usb2dyn.read(id, readRegister, config.payload, timeout);
+				return timeoutFlag ? Outcome::Timeout : motorID != id ? Outcome::Error : Outcome::Ok;
+			} else if (config.workload == "sync_read") {
+				return syncRead(wireBytes);
+			} else if (config.workload == "bulk_read") {
+				wireBytes += wire.instruction(wire.v2 ? 5*n : 1 + 3*n) + n * wire.status(config.payload);
+				return usb2dyn.bulk_read(bulkRequest, timeout).size() == n ? Outcome::Ok : Outcome::Timeout;
+			} else if (config.workload == "sync_write") {
+				// a SYNC_WRITE is not answered, the ping waits until it went over the bus
+				syncWrite(wireBytes);
+				wireBytes += wire.ping();
+				return usb2dyn.ping(config.motors.front(), timeout) ? Outcome::Ok : Outcome::Timeout;
+			} else if (config.workload == "mixed") {
+				// one cycle of a control loop
+				syncWrite(wireBytes);
+				return syncRead(wireBytes);
+			}
+			throw std::runtime_error("unknown workload \"" + config.workload + "\"");
+		};
+
+		auto histogram = std::make_unique<LatencyHistogram>();
+		uint64_t timeouts {0};
+		uint64_t errors {0};
+		std::size_t successfulWireBytes {0};
+		auto start = std::chrono::steady_clock::now();
+		for (int i{0}; i < transactions; ++i) {
+			std::size_t wireBytes {0};
+			auto t0 = std::chrono::steady_clock::now();
+			auto outcome = execute(i, wireBytes);
+			auto t1 = std::chrono::steady_clock::now();
+			if (outcome == Outcome::Ok) {
+				histogram->record(t1 - t0);
+				successfulWireBytes += wireBytes;
+			} else if (outcome == Outcome::Timeout) {
+				++timeouts;
+			} else {
+				++errors;
+			}
+		}
+		auto elapsed = std::chrono::duration<double>{std::chrono::steady_clock::now() - start}.count();
+		// 8N1: 10 bits per byte
+		auto wireTime = successfulWireBytes * 10. / baudrate;
+
+		return Result{config, uint64_t(transactions), timeouts, errors,
+			histogram->percentile(.5), histogram->percentile(.9), histogram->percentile(.99), histogram->max(), histogram->mean(),
+			transactions / elapsed, wireTime / elapsed};
+	}
+};
+
+auto microseconds(std::chrono::nanoseconds d) -> double {
+	return std::chrono::duration<double, std::micro>{d}.count();
+}
+
+void printTable(std::vector<Result> const& results) {
+	std::cout << std::left << std::setw(11) << "workload" << std::right
+	          << std::setw(7) << "motors" << std::setw(8) << "payload" << std::setw(7) << "trans"
+	          << std::setw(10) << "p50[us]" << std::setw(10) << "p90[us]" << std::setw(10) << "p99[us]" << std::setw(10) << "max[us]"
+	          << std::setw(10) << "trans/s" << std::setw(7) << "bus%" << std::setw(10) << "timeouts" << std::setw(8) << "errors" << "\n";
+	std::cout << std::fixed << std::setprecision(0);
+	for (auto const& r : results) {
+		std::cout << std::left << std::setw(11) << r.config.workload << std::right
+		          << std::setw(7) << r.config.motors.size() << std::setw(8) << r.config.payload << std::setw(7) << r.transactions
+		          << std::setw(10) << microseconds(r.p50) << std::setw(10) << microseconds(r.p90) << std::setw(10) << microseconds(r.p99) << std::setw(10) << microseconds(r.max)
+		          << std::setw(10) << r.transactionsPerSecond << std::setw(7) << 100. * r.busUtilization
+		          << std::setw(10) << r.timeouts << std::setw(8) << r.errors << "\n";
+	}
+}
+
+void printJSON(std::vector<Result> const& results, std::string const& device, Protocol protocol, int baudrate) {
+	std::cout << "{\"version\":1,\"device\":\"" << device << "\",\"protocol\":" << int(protocol) << ",\"baudrate\":" << baudrate << ",\"results\":[";
+	for (std::size_t i{0}; i < results.size(); ++i) {
+		auto const& r = results[i];
+		std::cout << (i ? "," : "") << "\n  {\"workload\":\"" << r.config.workload << "\",\"motors\":" << r.config.motors.size() << ",\"payload\":" << r.config.payload
+		          << ",\"transactions\":" << r.transactions << ",\"timeouts\":" << r.timeouts << ",\"errors\":" << r.errors
+		          << ",\"latency_us\":{\"p50\":" << microseconds(r.p50) << ",\"p90\":" << microseconds(r.p90) << ",\"p99\":" << microseconds(r.p99)
+		          << ",\"max\":" << microseconds(r.max) << ",\"mean\":" << microseconds(r.mean) << "}"
+		          << ",\"transactions_per_second\":" << r.transactionsPerSecond << ",\"bus_utilization\":" << r.busUtilization << "}";
+	}
+	std::cout << "\n]}\n";
+}
+
+void runBench() {
+	auto timeout  = std::chrono::microseconds{*g_timeout};
+	auto protocol = *g_protocolVersion;
+	auto device   = *g_device;
+
+	// the simulator runs in this process, its motors are known without detection
+	std::unique_ptr<Simulator> simulator;
+	std::atomic<bool> stopSimulator {false};
+	std::thread simulatorThread;
+	std::optional<LayoutType> layoutType;
+	std::vector<MotorID> motors;
+	if (*optSimulate > 0) {
+		auto modelName = optSimModel->empty() ? (protocol == Protocol::V2 ? "XM430-W350" : "MX28") : *optSimModel;
+		auto info = meta::getMotorInfo(modelName);
+		if (not info) {
+			throw std::runtime_error("unknown model \"" + modelName + "\"");
+		}
+		std::vector<SimulatedMotor> specs;
+		for (int id{1}; id <= std::min(*optSimulate, int(BroadcastID) - 1); ++id) {
+			specs.push_back({MotorID(id), info->modelNumber, *optSimDelay < 0 ? std::nullopt : std::make_optional(std::chrono::microseconds{*optSimDelay})});
+			motors.push_back(MotorID(id));
+		}
+		simulator = std::make_unique<Simulator>(specs, Simulator::Options{protocol, *g_baudrate, 0., 0., 0});
+		simulatorThread = std::thread{[&] { simulator->run(stopSimulator); }};
+		device     = simulator->getDevice();
+		layoutType = info->layout;
+	}
+
+	try {
+		// opening the port and detection print their progress, keep stdout clean for the JSON document
+		auto coutBuffer = optJSON ? std::cout.rdbuf(std::cerr.rdbuf()) : std::cout.rdbuf();
+		auto usb2dyn = USB2Dynamixel(*g_baudrate, device, protocol, not simulator);
+		if (not simulator) {
+			auto [layout, detected] = detectMotorsOfOneLayout(*optIDs, usb2dyn, timeout);
+			layoutType = layout;
+			motors     = detected;
+		}
+		std::cout.rdbuf(coutBuffer);
+		auto writeRegister = *optWriteReg >= 0 ? *optWriteReg : findRegister(*layoutType, "Goal Position");
+		auto bench = Bench{usb2dyn, timeout, Wire{usb2dyn.getProtocol() == Protocol::V2}, *g_baudrate, *optReadRegister, writeRegister};
+
+		std::vector<Result> results;
+		for (auto const& workload : *optWorkloads) {
+			// ping and read address one motor per transaction, they cycle through all motors
+			bool single = workload == "ping" or workload == "read";
+			auto counts = single ? std::vector<int>{int(motors.size())} : *optMotorCounts;
+			auto payloads = workload == "ping" ? std::vector<int>{0} : *optPayloads;
+			for (auto count : counts) {
+				if (count <= 0 or count > int(motors.size())) {
+					std::cerr << "skipping " << workload << " with " << count << " motors, only " << motors.size() << " are available\n";
+					continue;
+				}
+				for (auto payload : payloads) {
+					auto config = Config{workload, std::vector<MotorID>(motors.begin(), motors.begin() + count), std::size_t(payload)};
+					try {
+						results.push_back(bench.run(config, std::max(1, *optTransactions)));
+					} catch (std::runtime_error const& e) {
+						// e.g. a write window that reaches beyond the control table
+						std::cerr << "skipping " << workload << " with " << count << " motors and payload " << payload << ": " << e.what() << "\n";
+					}
+				}
+			}
+		}
+
+		if (optJSON) {
+			printJSON(results, device, usb2dyn.getProtocol(), *g_baudrate);
+		} else {
+			printTable(results);
+		}
+	} catch (...) {
+		stopSimulator = true;
+		if (simulatorThread.joinable()) {
+			simulatorThread.join();
+		}
+		throw;
+	}
+	stopSimulator = true;
+	if (simulatorThread.joinable()) {
+		simulatorThread.join();
+	}
+}
+
+}
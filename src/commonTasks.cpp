@@ -16,9 +16,77 @@ auto detectMotor(MotorID motor, USB2Dynamixel& usb2dyn, std::chrono::microsecond
 	auto modelPtr = meta::getMotorInfo(layout.model_number);
 	if (modelPtr) {
 		std::cout << int(motor) << " " <<  modelPtr->shortName << " (" << layout.model_number << ") Layout " << to_string(modelPtr->layout) << "\n";
+		usb2dyn.learnStatusReturnLevel(motor, modelPtr->layout, timeout);
 		return std::make_tuple(modelPtr->layout, layout.model_number);
 	}
 
 	std::cout << int(motor) << " unknown model (" << layout.model_number << ")\n";
 	return std::make_tuple(LayoutType::None, layout.model_number);
 }
+
+auto detectMotorsOfOneLayout(std::set<int> const& ids, USB2Dynamixel& usb2dyn, std::chrono::microseconds timeout) -> std::tuple<LayoutType, std::vector<MotorID>> {
+	auto range = ids;
+	if (range.empty()) {
+		for (int i{0}; i < 0xFE; ++i) {
+			range.insert(i);
+		}
+	}
+
+	std::optional<LayoutType> layoutType;
+	std::vector<MotorID> motors;
+	for (auto id : range) {
+		auto [layout, modelNumber] = detectMotor(MotorID(id), usb2dyn, timeout);
+		if (modelNumber == 0 or layout == LayoutType::None) {
+			continue;
+		}
+		if (not layoutType) {
+			layoutType = layout;
+		}
+		if (layout != *layoutType) {
+			std::cout << "skipping motor " << id << ", its layout " << to_string(layout) << " differs from " << to_string(*layoutType) << "\n";
+			continue;
+		}
+		motors.push_back(MotorID(id));
+	}
+	if (motors.empty()) {
+		throw std::runtime_error("no motors found");
+	}
+	return {*layoutType, motors};
+}
+
+auto findRegister(LayoutType layoutType, std::string const& name) -> int {
+	std::optional<int> reg;
+	meta::forAllLayoutTypes([&](auto const& info) {
+		using Info = std::decay_t<decltype(info)>;
+		if (Info::Type != layoutType) {
+			return;
+		}
+		for (auto const& [_reg, field] : Info::getInfos()) {
+			if (field.name == name) {
+				reg = int(_reg);
+			}
+		}
+	});
+	if (not reg) {
+		throw std::runtime_error("layout " + to_string(layoutType) + " has no register \"" + name + "\"");
+	}
+	return *reg;
+}
+
+auto describeRegisters(LayoutType layoutType, std::vector<int> const& registers) -> std::vector<TelemetryFrame::ColumnDescription> {
+	std::vector<TelemetryFrame::ColumnDescription> columns;
+	meta::forAllLayoutTypes([&](auto const& info) {
+		using Info = std::decay_t<decltype(info)>;
+		if (Info::Type != layoutType) {
+			return;
+		}
+		for (auto reg : registers) {
+			auto description = describeRegister<typename Info::FullLayout>(reg);
+			if (not description) {
+				throw std::runtime_error("register " + std::to_string(reg) + " is not a scalar register of layout " + to_string(layoutType));
+			}
+			columns.push_back(*description);
+		}
+	});
+	return columns;
+}
@@ -4,6 +4,19 @@
 #include "usb2dynamixel/MotorMetaInfo.h"
 
 #include <chrono>
+#include <set>
+#include <string>
+#include <tuple>
+#include <vector>
 
 auto detectMotor(dynamixel::MotorID motor, dynamixel::USB2Dynamixel& usb2dyn, std::chrono::microseconds timeout) -> std::tuple<dynamixel::LayoutType, uint16_t>;
 
+
+// detect the motors in ids and keep those that share the layout of the first detected motor (e.g. for bulk reads of one register window)
+auto detectMotorsOfOneLayout(std::set<int> const& ids, dynamixel::USB2Dynamixel& usb2dyn, std::chrono::microseconds timeout) -> std::tuple<dynamixel::LayoutType, std::vector<dynamixel::MotorID>>;
+
+// address of the register called name (e.g. "Present Position") in a layout, throws if the layout has no such register
+auto findRegister(dynamixel::LayoutType layout, std::string const& name) -> int;
+
+// telemetry columns for registers of a layout, throws if a register is not a scalar register of the layout
+auto describeRegisters(dynamixel::LayoutType layout, std::vector<int> const& registers) -> std::vector<dynamixel::TelemetryFrame::ColumnDescription>;
@@ -0,0 +1,134 @@
+#include "usb2dynamixel/USB2Dynamixel.h"
+#include "usb2dynamixel/CyclicExecutor.h"
+#include "globalOptions.h"
+
+#include "commonTasks.h"
+
+#include <atomic>
+#include <csignal>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+namespace {
+
+void runCycle();
+auto cycleCmd        = sargp::Command{"cycle", "run a fixed rate read/write loop, goal values are read from stdin as lines of \"<id> <value> [<id> <value>...]\"", runCycle};
+auto optIDs          = cycleCmd.Parameter<std::set<int>>({}, "ids", "motors to control (default: all detected motors)");
+auto optRegisters    = cycleCmd.Parameter<std::vector<int>>({}, "registers", "registers read every cycle (default: present position)");
+auto optCommandReg   = cycleCmd.Parameter<int>(-1, "command_register", "register written every cycle (default: goal position)");
+auto optRate         = cycleCmd.Parameter<int>(500, "rate_hz", "cycles per second");
+auto optPriority     = cycleCmd.Parameter<int>(0, "priority", "run the loop with this SCHED_FIFO priority (1..99, needs privileges)");
+auto optCpus         = cycleCmd.Parameter<std::set<int>>({}, "cpus", "pin the loop to these cpus");
+auto optLockMemory   = cycleCmd.Flag("mlock", "lock all memory of the process (mlockall) to avoid page faults in the loop");
+auto optPrint        = cycleCmd.Flag("print", "print the read registers of every cycle");
+auto optStatInterval = cycleCmd.Parameter<int>(1, "stats_interval", "print loop statistics every this many seconds (0: only at the end)");
+
+using namespace dynamixel;
+
+std::atomic<bool> terminateFlag {false};
+
+void printStats(CyclicExecutor::Stats const& stats, std::chrono::nanoseconds period) {
+	using namespace std::chrono;
+	auto cycles = std::max<uint64_t>(1, stats.cycles);
+	std::cerr << "cycles: " << stats.cycles
+		<< " overruns: " << stats.overruns
+		<< " deadline misses: " << stats.deadlineMisses
+		<< " incomplete reads: " << stats.incompleteReads
+		<< " jitter avg/max: " << duration_cast<microseconds>(stats.totalJitter / cycles).count() << "/" << duration_cast<microseconds>(stats.maxJitter).count() << "us"
+		<< " cycle avg/max: " << duration_cast<microseconds>(stats.totalCycleTime / cycles).count() << "/" << duration_cast<microseconds>(stats.maxCycleTime).count() << "us"
+		<< " (period " << duration_cast<microseconds>(period).count() << "us)"
+		<< " cpu: " << duration_cast<milliseconds>(stats.cpuTime).count() << "ms\n";
+}
+
+// little endian encoding of value in width bytes
+auto encodeValue(int64_t value, std::size_t width) -> Parameter {
+	Parameter data(width);
+	for (std::size_t i{0}; i < width; ++i) {
+		data[i] = std::byte((value >> (8*i)) & 0xff);
+	}
+	return data;
+}
+
+void runCycle() {
+	auto timeout = std::chrono::microseconds{*g_timeout};
+	auto usb2dyn = USB2Dynamixel(*g_baudrate, *g_device, *g_protocolVersion);
+
+	auto [layoutType, motors] = detectMotorsOfOneLayout(*optIDs, usb2dyn, timeout);
+	auto registers = *optRegisters;
+	if (registers.empty()) {
+		registers.push_back(findRegister(layoutType, "Present Position"));
+	}
+	int commandRegister = *optCommandReg >= 0 ? *optCommandReg : findRegister(layoutType, "Goal Position");
+	auto commandWidth   = describeRegisters(layoutType, {commandRegister}).front().width;
+
+	CyclicExecutor::Options options;
+	options.period     = std::chrono::nanoseconds{std::chrono::seconds{1}} / std::max(1, *optRate);
+	options.timeout    = timeout;
+	options.cpus       = *optCpus;
+	options.lockMemory = optLockMemory;
+	if (*optPriority > 0) {
+		options.priority = *optPriority;
+	}
+	auto executor = CyclicExecutor{usb2dyn, motors, TelemetryFrame{describeRegisters(layoutType, registers)}, commandRegister, options};
+
+	// the newest goal of every motor, filled by the stdin reader
+	std::mutex goalMutex;
+	std::map<MotorID, Parameter> goals;
+	std::thread reader([&] {
+		std::string line;
+		while (not terminateFlag and std::getline(std::cin, line)) {
+			std::stringstream ss{line};
+			int id;
+			int64_t value;
+			auto g = std::lock_guard(goalMutex);
+			while (ss >> id >> value) {
+				goals[MotorID(id)] = encodeValue(value, commandWidth);
+			}
+		}
+	});
+	reader.detach(); // std::getline cannot be interrupted, the thread ends with the process
+
+	auto sigHandler = [](int){ terminateFlag = true; };
+	std::signal(SIGINT, sigHandler);
+	std::signal(SIGTERM, sigHandler);
+
+	std::thread statsPrinter;
+	if (*optStatInterval > 0) {
+		statsPrinter = std::thread([&, period=options.period] {
+			auto next = std::chrono::steady_clock::now();
+			while (not terminateFlag) {
+				next += std::chrono::seconds{*optStatInterval};
+				while (not terminateFlag and std::chrono::steady_clock::now() < next) {
+					std::this_thread::sleep_for(std::chrono::milliseconds{50});
+				}
+				printStats(executor.getStats(), period);
+			}
+		});
+	}
+
+	executor.run([&](TelemetryFrame const& state, std::map<MotorID, Parameter>& commands) {
+		if (optPrint) {
+			for (std::size_t m{0}; m < state.motors.size(); ++m) {
+				std::cout << int(state.motors[m]);
+				for (auto const& column : state.columns) {
+					std::cout << " " << column.values[m];
+				}
+				std::cout << (m + 1 < state.motors.size() ? "  " : "\n");
+			}
+		}
+		// try_lock: never wait for the stdin reader, the goals are sent again next cycle
+		if (goalMutex.try_lock()) {
+			commands = goals;
+			goalMutex.unlock();
+		}
+	}, terminateFlag);
+
+	if (statsPrinter.joinable()) {
+		statsPrinter.join();
+	} else {
+		printStats(executor.getStats(), options.period);
+	}
+}
+
+}
@@ -0,0 +1,193 @@
+#include "usb2dynamixel/WireCapture.h"
+#include "usb2dynamixel/ProtocolV1.h"
+#include "usb2dynamixel/ProtocolV2.h"
+#include "usb2dynamixel/USB2Dynamixel.h"
+#include "globalOptions.h"
+
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace {
+
+void runDecode();
+auto decodeCmd = sargp::Command{"decode", "print the packets of a capture written with --capture", runDecode};
+auto optFile   = decodeCmd.Parameter<std::string>("", "file", "the capture to decode");
+auto optRaw    = decodeCmd.Flag("raw", "print every packet as it was on the wire as well");
+
+using namespace dynamixel;
+
+auto hex(Parameter::const_iterator begin, Parameter::const_iterator end) -> std::string {
+	std::stringstream ss;
+	ss << std::hex << std::setfill('0');
+	for (auto it = begin; it != end; ++it) {
+		ss << (it == begin ? "" : " ") << std::setw(2) << int(*it);
+	}
+	return ss.str();
+}
+
+struct Packet {
+	MotorID     motor;
+	Instruction instruction; // STATUS for status packets
+	uint8_t     error;
+	Parameter   parameters;
+};
+
+/**
+ * the bytes of one direction, cut into packets with the same rules readPacket uses:
+ * search the header, take as many bytes as the length field says and validate the checksum
+ */
+struct Stream {
+	capture::Direction                    direction;
+	bool                                  v2;
+	Parameter                             bytes;
+	std::vector<std::chrono::nanoseconds> timestamps; // of every byte in bytes
+	uint64_t                              packets {0};
+	uint64_t                              invalid {0};
+	uint64_t                              garbage {0};
+
+	void append(capture::Record const& record) {
+		bytes.insert(bytes.end(), record.data.begin(), record.data.end());
+		timestamps.insert(timestamps.end(), record.data.size(), record.timestamp);
+	}
+
+	[[nodiscard]] auto headerLength() const -> std::size_t { return v2 ? 7 : 4; }
+	[[nodiscard]] bool isHeader(std::size_t pos) const {
+		static constexpr std::byte marker[] = {std::byte{0xff}, std::byte{0xff}, std::byte{0xfd}, std::byte{0x00}};
+		std::size_t markerLength = v2 ? 4 : 2;
+		return bytes.size() - pos >= markerLength and std::equal(marker, marker + markerLength, std::next(bytes.begin(), pos));
+	}
+
+	auto decode(Parameter const& raw) const -> Packet {
+		if (not v2) {
+			auto instructionOrError = uint8_t(raw[4]);
+			auto parameters = Parameter(std::next(raw.begin(), 5), std::prev(raw.end()));
+			if (direction == capture::Direction::Rx) {
+				return Packet{MotorID(raw[2]), Instruction::STATUS, instructionOrError, std::move(parameters)};
+			}
+			return Packet{MotorID(raw[2]), Instruction(instructionOrError), 0, std::move(parameters)};
+		}
+		auto instruction = Instruction(raw[7]);
+		std::size_t first = instruction == Instruction::STATUS ? 9 : 8;
+		auto parameters = detail::v2::removeEscapes(std::next(raw.begin(), first), std::prev(raw.end(), 2));
+		return Packet{MotorID(raw[4]), instruction, instruction == Instruction::STATUS ? uint8_t(raw[8]) : uint8_t{0}, std::move(parameters)};
+	}
+
+	/**
+	 * print all complete packets
+	 * flush: no more bytes will complete a started packet (the capture ended or the master sent something, so it gave up waiting),
+	 * a started packet is reported as incomplete and the search for headers continues after its first byte
+	 */
+	template <typename Print>
+	void process(bool flush, Print&& print) {
+		std::size_t pos {0};
+		auto skip = [&](std::size_t count) {
+			print(timestamps[pos], "garbage " + hex(std::next(bytes.begin(), pos), std::next(bytes.begin(), pos + count)));
+			garbage += count;
+			pos += count;
+		};
+		while (pos < bytes.size()) {
+			std::size_t start = pos;
+			while (start < bytes.size() and not isHeader(start)) {
+				++start;
+			}
+			// a partial header might be at the end
+			if (start == bytes.size() and not flush) {
+				start = std::max(pos, bytes.size() - std::min<std::size_t>(bytes.size(), v2 ? 3 : 1));
+				if (start > pos) {
+					skip(start - pos);
+				}
+				break;
+			}
+			if (start > pos) {
+				skip(start - pos);
+				continue;
+			}
+			std::size_t length = bytes.size() - pos < headerLength() ? headerLength()
+			                   : v2 ? 7 + (std::size_t(bytes[pos + 5]) | (std::size_t(bytes[pos + 6]) << 8)) : 4 + std::size_t(bytes[pos + 3]);
+			if (bytes.size() - pos < length) {
+				if (not flush) {
+					break;
+				}
+				++invalid;
+				print(timestamps[pos], "incomplete " + hex(std::next(bytes.begin(), pos), bytes.end()));
+				++pos;
+				continue;
+			}
+			auto raw = Parameter(std::next(bytes.begin(), pos), std::next(bytes.begin(), pos + length));
+			bool valid = length >= (v2 ? 10 : 6) and (v2 ? detail::v2::validatePacket(raw) : detail::v1::validatePacket(raw));
+			if (not valid) {
+				// skip the first byte of the header only, the real packet might start within this one
+				++invalid;
+				print(timestamps[pos], "invalid " + hex(raw.begin(), raw.end()));
+				++pos;
+				continue;
+			}
+			++packets;
+			auto packet = decode(raw);
+			std::stringstream ss;
+			ss << "id " << std::setw(3) << int(packet.motor) << " " << std::left << std::setw(10) << to_string(packet.instruction) << std::right;
+			if (packet.instruction == Instruction::STATUS) {
+				ss << " error 0x" << std::hex << std::setw(2) << std::setfill('0') << int(packet.error) << std::dec << std::setfill(' ');
+			}
+			if (not packet.parameters.empty()) {
+				ss << " | " << hex(packet.parameters.begin(), packet.parameters.end());
+			}
+			if (optRaw) {
+				ss << "\n" << std::string(22, ' ') << "raw: " << hex(raw.begin(), raw.end());
+			}
+			print(timestamps[pos], ss.str());
+			pos += length;
+		}
+		bytes.erase(bytes.begin(), std::next(bytes.begin(), pos));
+		timestamps.erase(timestamps.begin(), std::next(timestamps.begin(), pos));
+	}
+};
+
+void runDecode() {
+	if (optFile->empty()) {
+		throw std::runtime_error("no capture given (--file)");
+	}
+	auto capture  = capture::read(*optFile);
+	// the protocol can be overridden, e.g. if the capturing call was given the wrong one
+	auto protocol = g_protocolVersion ? *g_protocolVersion : Protocol(capture.header.protocol);
+	bool v2       = protocol == Protocol::V2;
+	std::cout << "capture of " << capture.records.size() << " reads and writes at " << capture.header.baudrate << " baud, protocol " << int(protocol) << "\n";
+
+	auto start = capture.records.empty() ? std::chrono::nanoseconds{capture.header.startMonotonic} : capture.records.front().timestamp;
+	auto print = [&](capture::Direction direction) {
+		return [&, direction](std::chrono::nanoseconds timestamp, std::string const& text) {
+			std::cout << std::fixed << std::setprecision(6) << std::setw(14) << std::chrono::duration<double>{timestamp - start}.count()
+			          << (direction == capture::Direction::Tx ? " tx " : " rx ") << text << "\n";
+		};
+	};
+
+	Stream tx{capture::Direction::Tx, v2, {}, {}};
+	Stream rx{capture::Direction::Rx, v2, {}, {}};
+	uint64_t lost {0};
+	for (auto const& record : capture.records) {
+		if (record.lost > 0) {
+			std::cout << record.lost << " records lost\n";
+			lost += record.lost;
+		}
+		auto& stream = record.direction == capture::Direction::Tx ? tx : rx;
+		if (record.direction == capture::Direction::Tx) {
+			rx.process(true, print(rx.direction));
+		}
+		stream.append(record);
+		stream.process(false, print(stream.direction));
+	}
+	tx.process(true, print(tx.direction));
+	rx.process(true, print(rx.direction));
+
+	std::cout << "tx: " << tx.packets << " packets, " << tx.invalid << " invalid, " << tx.garbage << " garbage bytes\n";
+	std::cout << "rx: " << rx.packets << " packets, " << rx.invalid << " invalid, " << rx.garbage << " garbage bytes\n";
+	if (lost > 0) {
+		std::cout << lost << " records were lost while capturing\n";
+	}
+	if (capture.truncated) {
+		std::cout << "the capture is truncated\n";
+	}
+}
+
+}
@@ -1,5 +1,6 @@
 #include "usb2dynamixel/USB2Dynamixel.h"
 #include "usb2dynamixel/MotorMetaInfo.h"
+#include "usb2dynamixel/Remote.h"
 #include "globalOptions.h"
 
 #include "commonTasks.h"
@@ -140,6 +141,10 @@ auto readDetailedInfos(dynamixel::USB2Dynamixel& usb2dyn, std::vector<std::tuple
 }
 
 void runDetect() {
+	// detect tries settings the daemon does not use, opening the port next to it would garble the traffic of both
+	if (dynamixel::remote::Client::connect(dynamixel::remote::socketPath(*g_device))) {
+		throw std::runtime_error("an \"inspexel serve\" daemon owns " + *g_device + ", stop it before running detect");
+	}
 	baudrates->emplace(*g_baudrate);
 	auto timeout = std::chrono::microseconds{*g_timeout};
 	auto protocols = std::vector<dynamixel::Protocol>{dynamixel::Protocol::V1, dynamixel::Protocol::V2};
@@ -150,7 +155,7 @@ void runDetect() {
 		std::cout << "# trying protocol version " << int(protocolVersion) << "\n";
 		for (auto baudrate : *baudrates) {
 			std::cout << "## trying baudrate: " << baudrate << "\n";
-			auto usb2dyn = dynamixel::USB2Dynamixel(baudrate, *g_device, protocolVersion);
+			auto usb2dyn = dynamixel::USB2Dynamixel(baudrate, *g_device, protocolVersion, false);
 
 			// generate range to check
 			std::vector<int> range(0xFD);
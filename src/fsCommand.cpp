@@ -9,7 +9,14 @@
 #include <algorithm>
 #include <numeric>
 #include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <future>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <thread>
 
 #include <unistd.h>
 #include <functional>
@@ -22,32 +29,356 @@ auto interactCmd  = sargp::Command{"fuse", "create a fuse fs representing the co
 auto optTimeout   = interactCmd.Parameter<int>(10000, "timeout", "timeout in us");
 auto ids          = interactCmd.Parameter<std::set<int>>({}, "ids", "the target Id");
 auto mountPoint   = interactCmd.Parameter<std::string>("dynamixelFS", "mountpoint", "where to mount the fuse filesystem representing the motors");
+auto optCacheMs   = interactCmd.Parameter<int>(0, "cache_ms", "refresh all registers every cache_ms milliseconds in the background and serve reads from memory (0 disables the cache)");
+auto optWorkers   = interactCmd.Parameter<int>(4, "workers", "number of threads reading and writing files concurrently (0 processes them one at a time)");
+auto optMaxStale  = interactCmd.Parameter<int>(0, "max_staleness_ms", "maximal age of a cached register in milliseconds before a read goes to the bus (default: 2*cache_ms)");
+auto optWriteWin  = interactCmd.Parameter<int>(0, "write_window_ms", "collect register writes for write_window_ms milliseconds and send them together (0 writes immediately)");
+auto optHoldWrite = interactCmd.Flag("hold_writes", "collect register writes until something is written to the commit file");
+auto optStatsSec  = interactCmd.Parameter<int>(0, "stats_interval", "print the bus statistics every stats_interval seconds (0 disables it)");
 using namespace dynamixel;
 
-struct RegisterFile : simplyfuse::FuseFile {
-	RegisterFile(MotorID _motorID, int _registerID, meta::LayoutField const& _layoutField, USB2Dynamixel &_usb2dyn)
-		: motorID(_motorID)
+// holds the full register content of every motor, refreshed by a background poller
+struct RegisterCache {
+	using Clock = std::chrono::steady_clock;
+
+	struct Entry {
+		int               baseRegister;
+		Parameter         data;
+		Clock::time_point timestamp;
+	};
+
+	RegisterCache(std::chrono::milliseconds _maxStaleness) : maxStaleness{_maxStaleness} {}
+
+	// returns the cached content of [reg, reg+length) if it is fresh enough
+	auto get(MotorID motor, int reg, std::size_t length) const -> std::optional<Parameter> {
+		auto g = std::lock_guard(mutex);
+		auto iter = entries.find(motor);
+		if (iter == entries.end()) {
+			return std::nullopt;
+		}
+		auto const& entry = iter->second;
+		int offset = reg - entry.baseRegister;
+		if (Clock::now() - entry.timestamp > maxStaleness or offset < 0 or offset + length > entry.data.size()) {
+			return std::nullopt;
+		}
+		return Parameter(std::next(entry.data.begin(), offset), std::next(entry.data.begin(), offset + length));
+	}
+
+	void update(MotorID motor, int baseRegister, Parameter data) {
+		auto g = std::lock_guard(mutex);
+		entries[motor] = Entry{baseRegister, std::move(data), Clock::now()};
+	}
+
+	// write-through of values that were written to or freshly read from a motor
+	void patch(MotorID motor, int reg, Parameter const& data) {
+		Entry before;
+		Parameter after;
+		{
+			auto g = std::lock_guard(mutex);
+			auto iter = entries.find(motor);
+			if (iter == entries.end()) {
+				return;
+			}
+			auto& entry = iter->second;
+			int offset = reg - entry.baseRegister;
+			if (offset < 0 or offset + data.size() > entry.data.size()) {
+				return;
+			}
+			auto first = std::next(entry.data.begin(), offset);
+			if (std::equal(data.begin(), data.end(), first) or not onPatch) {
+				std::copy(data.begin(), data.end(), first);
+				return;
+			}
+			before = entry;
+			std::copy(data.begin(), data.end(), first);
+			after = entry.data;
+		}
+		onPatch(motor, before.baseRegister, before.data, after);
+	}
+
+	void erase(MotorID motor) {
+		auto g = std::lock_guard(mutex);
+		entries.erase(motor);
+	}
+
+	std::chrono::milliseconds maxStaleness;
+	mutable std::mutex mutex;
+	std::map<MotorID, Entry> entries;
+
+	// called (without mutex) when patch changed the content of a motor: motor, base register, content before and after
+	std::function<void(MotorID, int, Parameter const&, Parameter const&)> onPatch;
+};
+
+/**
+ * register I/O of known motors has priority over probing for new motors:
+ * every read/write from the filesystem (and the cache refresh) holds a foreground guard,
+ * the detection job waits until no foreground I/O is in flight before every probe
+ * the cache refresh yields between its rounds, so it cannot starve the detection job if it runs back to back
+ */
+struct BusArbiter {
+	struct Guard {
+		BusArbiter& arbiter;
+		~Guard() {
+			if (--arbiter.foreground == 0) {
+				{ auto g = std::lock_guard(arbiter.mutex); }
+				arbiter.cv.notify_all();
+			}
+		}
+	};
+
+	struct BackgroundGuard {
+		BusArbiter& arbiter;
+		~BackgroundGuard() {
+			{
+				auto g = std::lock_guard(arbiter.mutex);
+				--arbiter.background;
+				++arbiter.backgroundTurns;
+			}
+			arbiter.cv.notify_all();
+		}
+	};
+
+	[[nodiscard]] auto foregroundIO() -> Guard {
+		++foreground;
+		return Guard{*this};
+	}
+
+	// waits until no foreground I/O is in flight
+	[[nodiscard]] auto backgroundIO() -> BackgroundGuard {
+		auto g = std::unique_lock(mutex);
+		++background;
+		cv.wait(g, [&]{ return foreground == 0; });
+		return BackgroundGuard{*this};
+	}
+
+	// lets a waiting background job have its turn (waits at most maxWait for it)
+	void yield(std::chrono::milliseconds maxWait) {
+		auto g = std::unique_lock(mutex);
+		if (background == 0) {
+			return;
+		}
+		auto turn = backgroundTurns;
+		cv.wait_for(g, maxWait, [&]{ return background == 0 or backgroundTurns != turn; });
+	}
+
+	std::atomic<int> foreground {0};
+	int background {0};            // guarded by mutex
+	uint64_t backgroundTurns {0};  // guarded by mutex
+	std::mutex mutex;
+	std::condition_variable cv;
+};
+
+/**
+ * all register writes of the filesystem go through here
+ * if batching is enabled writes are collected (the last write to a register wins) and sent together
+ * when the window expires or flush() is called:
+ * writes of the same register with the same length to several motors become one sync_write,
+ * everything else is sent as one synchronized_write (BULK_WRITE or REG_WRITE+ACTION)
+ */
+struct WriteBatcher {
+	using Clock = std::chrono::steady_clock;
+
+	WriteBatcher(USB2Dynamixel& _usb2dyn, RegisterCache* _cache, BusArbiter& _arbiter, bool _enabled, std::optional<std::chrono::milliseconds> _window)
+		: usb2dyn(_usb2dyn)
+		, cache(_cache)
+		, arbiter(_arbiter)
+		, enabled(_enabled)
+		, window(_window)
+	{}
+
+	void write(MotorID motor, int reg, Parameter param) {
+		if (not enabled) {
+			auto g = std::lock_guard(sendMutex);
+			auto io = arbiter.foregroundIO();
+			usb2dyn.write(motor, reg, param);
+			if (cache) {
+				cache->patch(motor, reg, param);
+			}
+			return;
+		}
+		auto g = std::lock_guard(mutex);
+		if (pending.empty() and window) {
+			deadline = Clock::now() + *window;
+		}
+		merge(motor, reg, std::move(param));
+		cv.notify_one();
+	}
+
+	void flush() {
+		auto sendLock = std::lock_guard(sendMutex);
+		std::map<std::pair<MotorID, int>, Parameter> toSend;
+		{
+			auto g = std::lock_guard(mutex);
+			std::swap(toSend, pending);
+		}
+		if (toSend.empty()) {
+			return;
+		}
+		auto io = arbiter.foregroundIO();
+
+		// group by register and length
+		std::map<std::pair<int, std::size_t>, std::map<MotorID, Parameter>> groups;
+		for (auto& [key, param] : toSend) {
+			groups[{key.second, param.size()}][key.first] = param;
+		}
+		std::vector<std::tuple<MotorID, int, Parameter>> rest;
+		for (auto& [key, motorParams] : groups) {
+			if (motorParams.size() > 1) {
+				usb2dyn.sync_write(motorParams, key.first);
+			} else {
+				auto& [motor, param] = *motorParams.begin();
+				rest.emplace_back(motor, key.first, std::move(param));
+			}
+		}
+		if (rest.size() == 1) {
+			auto const& [motor, reg, param] = rest.front();
+			usb2dyn.write(motor, reg, param);
+		} else if (not rest.empty()) {
+			try {
+				usb2dyn.synchronized_write(rest, std::chrono::microseconds{*g_timeout});
+			} catch (std::exception const&) {
+				// e.g. several registers of the same motor on protocol 2 which cannot be expressed as one bulk write
+				for (auto const& [motor, reg, param] : rest) {
+					usb2dyn.write(motor, reg, param);
+				}
+			}
+		}
+
+		if (cache) {
+			for (auto const& [key, param] : toSend) {
+				cache->patch(key.first, key.second, param);
+			}
+		}
+	}
+
+	// waits until the window of the pending writes expired (or some time passed) and sends them
+	void flushWhenDue() {
+		{
+			auto g = std::unique_lock(mutex);
+			if (not window) {
+				return;
+			}
+			if (not cv.wait_for(g, std::chrono::milliseconds{100}, [&]{ return not pending.empty(); })) {
+				return;
+			}
+			cv.wait_until(g, deadline, [&]{ return pending.empty(); });
+			if (pending.empty()) {
+				return;
+			}
+		}
+		flush();
+	}
+
+	// pending writes of a motor never overlap: a write that overlaps older ones is merged with them into one buffer
+	// (the newer bytes win), otherwise the flush order of the map would decide which bytes end up in the motor
+	// mutex must be held
+	void merge(MotorID motor, int reg, Parameter param) {
+		int end   = reg + int(param.size());
+		int first = reg;
+		int last  = end;
+		std::vector<decltype(pending)::iterator> overlapping;
+		for (auto it = pending.lower_bound({motor, std::numeric_limits<int>::min()}); it != pending.end() and it->first.first == motor; ++it) {
+			int otherFirst = it->first.second;
+			int otherLast  = otherFirst + int(it->second.size());
+			if (otherFirst < end and reg < otherLast) {
+				first = std::min(first, otherFirst);
+				last  = std::max(last, otherLast);
+				overlapping.push_back(it);
+			}
+		}
+		if (overlapping.empty()) {
+			pending[{motor, reg}] = std::move(param);
+			return;
+		}
+		Parameter merged(last - first);
+		for (auto it : overlapping) {
+			std::copy(it->second.begin(), it->second.end(), std::next(merged.begin(), it->first.second - first));
+			pending.erase(it);
+		}
+		std::copy(param.begin(), param.end(), std::next(merged.begin(), reg - first));
+		pending[{motor, first}] = std::move(merged);
+	}
+
+	USB2Dynamixel& usb2dyn;
+	RegisterCache* cache;
+	BusArbiter& arbiter;
+	bool enabled;
+	std::optional<std::chrono::milliseconds> window;
+
+	std::mutex sendMutex;
+	std::mutex mutex;
+	std::condition_variable cv;
+	Clock::time_point deadline;
+	std::map<std::pair<MotorID, int>, Parameter> pending;
+};
+
+struct CommitFile : simplyfuse::SimpleWOFile {
+	CommitFile(WriteBatcher& _batcher) : batcher{_batcher} {}
+
+	int onWrite(const char*, std::size_t size, off_t) override {
+		batcher.flush();
+		return size;
+	}
+
+	WriteBatcher& batcher;
+};
+
+// a file that represents the content of some registers of a motor
+struct RegisterBackedFile : simplyfuse::FuseFile {
+	virtual ~RegisterBackedFile() = default;
+	// base register and length of the represented registers
+	virtual auto registerRange() const -> std::pair<int, std::size_t> = 0;
+
+	bool useDirectIO() override {
+		return true;
+	}
+};
+
+// everything the files of one motor share
+struct MotorContext {
+	MotorID        motorID;
+	USB2Dynamixel& usb2dyn;
+	RegisterCache* cache;
+	WriteBatcher&  writer;
+	BusArbiter&    arbiter;
+};
+
+// a single register, the field description is shared by all motors of the same type
+struct RegisterFile : RegisterBackedFile {
+	RegisterFile(MotorContext const& _motor, int _registerID, meta::LayoutField const& _layoutField)
+		: motor(_motor)
 		, registerID(_registerID)
 		, layoutField(_layoutField)
-		, usb2dyn(_usb2dyn)
 	{}
 
 	virtual ~RegisterFile() = default;
 
-	int onRead(char* buf, std::size_t size, off_t)  override {
+	int onRead(char* buf, std::size_t size, off_t offset)  override {
 		if (not (int(layoutField.access) & int(meta::LayoutField::Access::R))) {
 			return -EINVAL;
 		}
-		auto [timeout, motor, error, parameters] = usb2dyn.read(motorID, registerID, layoutField.length, std::chrono::microseconds{g_timeout});
-		if (timeout or motor != motorID or parameters.size() != layoutField.length) {
-			return -EINVAL;
+		auto cached = motor.cache ? motor.cache->get(motor.motorID, registerID, layoutField.length) : std::nullopt;
+		if (not cached) {
+			auto io = motor.arbiter.foregroundIO();
+			auto [timeout, motorID, error, rxBuf] = motor.usb2dyn.read(motor.motorID, registerID, layoutField.length, std::chrono::microseconds{g_timeout});
+			if (timeout or motorID != motor.motorID or rxBuf.size() != layoutField.length) {
+				return -EINVAL;
+			}
+			if (motor.cache) {
+				motor.cache->patch(motor.motorID, registerID, rxBuf);
+			}
+			cached = std::move(rxBuf);
 		}
+		auto const& parameters = *cached;
 		int content {0};
 		memcpy(&content, parameters.data(), std::min(sizeof(content), std::size_t(layoutField.length)));
 
 		std::string renderedContent = std::to_string(content) + "\n";
-		size = std::min(size, renderedContent.size()+1);
-		std::memcpy(buf, renderedContent.data(), size);
+		if (offset < 0 or std::size_t(offset) >= renderedContent.size()) {
+			return 0;
+		}
+		size = std::min(size, renderedContent.size() - offset);
+		std::memcpy(buf, renderedContent.data() + offset, size);
 		return size;
 	}
 
@@ -63,7 +394,7 @@ struct RegisterFile : simplyfuse::FuseFile {
 			for (std::size_t i{0}; i < layoutField.length; ++i) {
 				param.emplace_back(std::byte{reinterpret_cast<uint8_t const*>(&toSet)[i]});
 			}
-			usb2dyn.write(motorID, registerID, param);
+			motor.writer.write(motor.motorID, registerID, std::move(param));
 			return size;
 		} catch (std::exception const&) {}
 		return -ENOENT;
@@ -77,6 +408,10 @@ struct RegisterFile : simplyfuse::FuseFile {
 		return 4096;
 	}
 
+	auto registerRange() const -> std::pair<int, std::size_t> override {
+		return {registerID, layoutField.length};
+	}
+
 	int getFilePermissions() override {
 		int permissions {0};
 		if (int(layoutField.access) & int(meta::LayoutField::Access::R)) {
@@ -88,10 +423,65 @@ struct RegisterFile : simplyfuse::FuseFile {
 		return permissions;
 	}
 
-	MotorID motorID;
+	MotorContext const& motor;
 	int registerID;
-	meta::LayoutField layoutField;
-	USB2Dynamixel &usb2dyn;
+	meta::LayoutField const& layoutField;
+};
+
+// the whole register table of a motor as binary file, offsets in the file are register addresses
+struct RawFile : RegisterBackedFile {
+	RawFile(MotorContext const& _motor, int _baseRegister, std::size_t _length)
+		: motor(_motor)
+		, baseRegister(_baseRegister)
+		, length(_length)
+	{}
+
+	int onRead(char* buf, std::size_t size, off_t offset) override {
+		if (offset < 0 or std::size_t(offset) >= length) {
+			return 0;
+		}
+		size = std::min(size, length - offset);
+		auto content = motor.cache ? motor.cache->get(motor.motorID, baseRegister + offset, size) : std::nullopt;
+		if (not content) {
+			auto io = motor.arbiter.foregroundIO();
+			auto [timeout, motorID, error, rxBuf] = motor.usb2dyn.read(motor.motorID, baseRegister + offset, size, std::chrono::microseconds{g_timeout});
+			if (timeout or motorID != motor.motorID or rxBuf.size() != size) {
+				return -EIO;
+			}
+			if (motor.cache) {
+				motor.cache->patch(motor.motorID, baseRegister + offset, rxBuf);
+			}
+			content = std::move(rxBuf);
+		}
+		std::memcpy(buf, content->data(), size);
+		return size;
+	}
+
+	int onWrite(const char* buf, std::size_t size, off_t offset) override {
+		if (offset < 0 or offset + size > length) {
+			return -EINVAL;
+		}
+		Parameter param(size);
+		std::memcpy(param.data(), buf, size);
+		motor.writer.write(motor.motorID, baseRegister + offset, std::move(param));
+		return size;
+	}
+
+	int onTruncate(off_t) override {
+		return 0;
+	}
+
+	std::size_t getSize() override {
+		return length;
+	}
+
+	auto registerRange() const -> std::pair<int, std::size_t> override {
+		return {baseRegister, length};
+	}
+
+	MotorContext const& motor;
+	int baseRegister;
+	std::size_t length;
 };
 
 struct PingFile : simplyfuse::SimpleWOFile {
@@ -114,28 +504,335 @@ struct PingFile : simplyfuse::SimpleWOFile {
 
 std::atomic<bool> terminateFlag {false};
 
+/**
+ * probes motor ids one after another in a background thread
+ * before every probe the job waits until no register I/O is in flight, so known motors are served at full speed while a scan is running
+ */
+struct DetectionJob {
+	DetectionJob(std::function<bool(MotorID)> _probe, BusArbiter& _arbiter)
+		: probe(std::move(_probe))
+		, arbiter(_arbiter)
+		, thread([this]{ run(); })
+	{}
+
+	~DetectionJob() {
+		{
+			auto g = std::lock_guard(mutex);
+			stop = true;
+			pending.clear();
+		}
+		cv.notify_all();
+		thread.join();
+	}
+
+	// queue ids for probing (ids that are already queued are skipped)
+	void scan(std::vector<MotorID> const& ids) {
+		{
+			auto g = std::lock_guard(mutex);
+			if (pending.empty() and not current) {
+				scanned = 0;
+				total   = 0;
+				found   = 0;
+			}
+			for (auto id : ids) {
+				if (std::find(begin(pending), end(pending), id) == end(pending)) {
+					pending.push_back(id);
+					++total;
+				}
+			}
+		}
+		cv.notify_all();
+	}
+
+	// drop all ids that are not probed yet
+	void cancel() {
+		auto g = std::lock_guard(mutex);
+		total -= pending.size();
+		pending.clear();
+	}
+
+	auto status() const -> std::string {
+		auto g = std::lock_guard(mutex);
+		std::string s = std::string{"state: "} + ((current or not pending.empty()) ? "scanning" : "idle") + "\n";
+		s += "progress: " + std::to_string(scanned) + "/" + std::to_string(total) + "\n";
+		s += "found: " + std::to_string(found) + "\n";
+		if (current) {
+			s += "current: " + std::to_string(*current) + "\n";
+		}
+		return s;
+	}
+
+private:
+	void run() {
+		while (true) {
+			{
+				auto g = std::unique_lock(mutex);
+				cv.wait(g, [&]{ return stop or not pending.empty(); });
+				if (stop) {
+					return;
+				}
+				current = pending.front();
+				pending.pop_front();
+			}
+			bool success = [&]{
+				auto io = arbiter.backgroundIO();
+				return probe(*current);
+			}();
+
+			auto g = std::lock_guard(mutex);
+			++scanned;
+			found += success ? 1 : 0;
+			current.reset();
+		}
+	}
+
+	std::function<bool(MotorID)> probe;
+	BusArbiter& arbiter;
+
+	mutable std::mutex mutex;
+	std::condition_variable cv;
+	std::deque<MotorID> pending;
+	std::optional<MotorID> current;
+	std::size_t scanned {0};
+	std::size_t total {0};
+	std::size_t found {0};
+	bool stop {false};
+
+	std::thread thread;
+};
+
+struct DetectionStatusFile : simplyfuse::FuseFile {
+	DetectionStatusFile(DetectionJob const& _job) : job{_job} {}
+
+	int onRead(char* buf, std::size_t size, off_t offset) override {
+		auto content = job.status();
+		if (offset < 0 or std::size_t(offset) >= content.size()) {
+			return 0;
+		}
+		size = std::min(size, content.size() - offset);
+		std::memcpy(buf, content.data() + offset, size);
+		return size;
+	}
+
+	int getFilePermissions() override {
+		return 0444;
+	}
+
+	bool useDirectIO() override {
+		return true;
+	}
+
+	DetectionJob const& job;
+};
+
+// the bus statistics as text (see BusStatistics::print), writing anything resets them
+struct StatsFile : simplyfuse::FuseFile {
+	StatsFile(USB2Dynamixel const& _usb2dyn) : usb2dyn{_usb2dyn} {}
+
+	int onRead(char* buf, std::size_t size, off_t offset) override {
+		std::stringstream ss;
+		usb2dyn.getStatistics().print(ss);
+		auto content = ss.str();
+		if (offset < 0 or std::size_t(offset) >= content.size()) {
+			return 0;
+		}
+		size = std::min(size, content.size() - offset);
+		std::memcpy(buf, content.data() + offset, size);
+		return size;
+	}
+
+	int onWrite(const char*, std::size_t size, off_t) override {
+		usb2dyn.resetStatistics();
+		return size;
+	}
+
+	int onTruncate(off_t) override {
+		return 0;
+	}
+
+	int getFilePermissions() override {
+		return 0644;
+	}
+
+	bool useDirectIO() override {
+		return true;
+	}
+
+	USB2Dynamixel const& usb2dyn;
+};
+
+// all files of a motor in one place, register files are stored in a deque (no allocation per register)
+struct MotorFiles {
+	MotorFiles(MotorContext _context, int _modelNumber, std::string const& modelName, int baseRegister, std::size_t length)
+		: context(_context)
+		, modelNumber(_modelNumber)
+		, modelFile(modelName + "\n")
+		, rawFile(context, baseRegister, length)
+	{}
+
+	MotorContext              context;
+	int                       modelNumber;
+	simplyfuse::SimpleROFile  modelFile;
+	RawFile                   rawFile;
+	std::deque<RegisterFile>  registerFiles;
+};
+
 template <LayoutType LT>
-std::vector<std::unique_ptr<simplyfuse::FuseFile>> registerMotor(MotorID motorID, int modelNumber, USB2Dynamixel& usb2dyn, simplyfuse::FuseFS& fuseFS) {
-	std::vector<std::unique_ptr<simplyfuse::FuseFile>> files;
+auto registerMotor(MotorContext const& context, int modelNumber, simplyfuse::FuseFS& fuseFS) -> std::unique_ptr<MotorFiles> {
+	using Info = meta::MotorLayoutInfo<LT>;
+	using FullLayout = typename Info::FullLayout;
 
 	auto motorInfoPtr = meta::getMotorInfo(modelNumber);
-	auto& motorModelFile = files.emplace_back(std::make_unique<simplyfuse::SimpleROFile>(motorInfoPtr->shortName + "\n"));
-	fuseFS.rmdir("/" + std::to_string(motorID));
-	fuseFS.registerFile("/" + std::to_string(motorID) + "/motor_model", *motorModelFile);
+	auto files = std::make_unique<MotorFiles>(context, modelNumber, motorInfoPtr->shortName, int(FullLayout::BaseRegister), FullLayout::Length);
+
+	// waits until no request uses the files of a previously registered motor anymore
+	auto motorDir = "/" + std::to_string(context.motorID);
+	fuseFS.rmdir(motorDir);
+	fuseFS.registerFile(motorDir + "/motor_model", files->modelFile);
+	fuseFS.registerFile(motorDir + "/raw", files->rawFile);
 
-	using Info = meta::MotorLayoutInfo<LT>;
 	auto const& defaults = Info::getDefaults().at(modelNumber).defaultLayout;
 	auto const& infos    = Info::getInfos();
 	for (auto const& [reg, entry] : defaults) {
 		//!TODO should register convert function here
 		auto const& info = infos.at(reg);
-		auto& newFile = files.emplace_back(std::make_unique<RegisterFile>(motorID, int(reg), info, usb2dyn));
-		fuseFS.registerFile("/" + std::to_string(motorID) + "/by-register-name/" + info.name, *newFile);
-		fuseFS.registerFile("/" + std::to_string(motorID) + "/by-register-id/" + std::to_string(int(reg)), *newFile);
+		auto& newFile = files->registerFiles.emplace_back(files->context, int(reg), info);
+		fuseFS.registerFile(motorDir + "/by-register-name/" + info.name, newFile);
+		fuseFS.registerFile(motorDir + "/by-register-id/" + std::to_string(int(reg)), newFile);
 	}
 	return files;
 }
 
+// refresh the cache of all known motors with one bulk_read per layout type
+void refreshCache(USB2Dynamixel& usb2dyn, RegisterCache& cache, std::map<MotorID, LayoutType> const& motors, std::chrono::microseconds timeout) {
+	meta::forAllLayoutTypes([&](auto const& info) {
+		using Info = std::decay_t<decltype(info)>;
+		using FullLayout = typename Info::FullLayout;
+		std::vector<std::tuple<MotorID, int, std::size_t>> request;
+		for (auto const& [motor, layout] : motors) {
+			if (layout == Info::Type) {
+				request.emplace_back(motor, int(FullLayout::BaseRegister), FullLayout::Length);
+			}
+		}
+		if (request.empty()) {
+			return;
+		}
+		auto response = usb2dyn.bulk_read(request, timeout);
+		for (auto const& [motor, baseRegister, errorCode, rxBuf] : response) {
+			cache.update(motor, baseRegister, rxBuf);
+		}
+		// bulk_read stops at the first motor that did not answer (or does not support bulk_read), read the rest one by one
+		for (auto iter = std::next(request.begin(), response.size()); iter != request.end(); ++iter) {
+			auto const& [motor, baseRegister, length] = *iter;
+			auto [timeoutFlag, motorID, errorCode, rxBuf] = usb2dyn.read(motor, baseRegister, length, timeout);
+			if (not timeoutFlag and motorID == motor) {
+				cache.update(motor, baseRegister, rxBuf);
+			}
+		}
+	});
+}
+
+// base register and length of the full register table of a layout
+auto getFullLayoutWindow(LayoutType layout) -> std::pair<int, std::size_t> {
+	std::pair<int, std::size_t> window {0, 0};
+	meta::forAllLayoutTypes([&](auto const& info) {
+		using Info = std::decay_t<decltype(info)>;
+		if (layout == Info::Type) {
+			window = {int(Info::FullLayout::BaseRegister), Info::FullLayout::Length};
+		}
+	});
+	return window;
+}
+
+/**
+ * the register tables of all motors in a single binary file
+ * for every motor (ascending ids) a record is stored:
+ *   uint8_t id, uint8_t layout type, uint16_t length (little endian), length bytes of register content
+ * a read at offset 0 takes a new snapshot (from the cache or one bulk_read per layout), reads at other offsets are served from that snapshot
+ */
+struct AllMotorsFile : simplyfuse::FuseFile {
+	static constexpr std::size_t RecordHeaderSize = 4;
+
+	AllMotorsFile(USB2Dynamixel &_usb2dyn, RegisterCache* _cache, BusArbiter& _arbiter, std::mutex& _motorsMutex, std::map<MotorID, LayoutType> const& _motors)
+		: usb2dyn(_usb2dyn)
+		, cache(_cache)
+		, arbiter(_arbiter)
+		, motorsMutex(_motorsMutex)
+		, motors(_motors)
+	{}
+
+	int onRead(char* buf, std::size_t size, off_t offset) override {
+		auto g = std::lock_guard(snapshotMutex);
+		if (offset == 0) {
+			takeSnapshot();
+		}
+		if (offset < 0 or std::size_t(offset) >= snapshot.size()) {
+			return 0;
+		}
+		size = std::min(size, snapshot.size() - offset);
+		std::memcpy(buf, snapshot.data() + offset, size);
+		return size;
+	}
+
+	std::size_t getSize() override {
+		auto g = std::lock_guard(motorsMutex);
+		std::size_t size {0};
+		for (auto const& [motor, layout] : motors) {
+			size += RecordHeaderSize + getFullLayoutWindow(layout).second;
+		}
+		return size;
+	}
+
+	int getFilePermissions() override {
+		return 0444;
+	}
+
+	bool useDirectIO() override {
+		return true;
+	}
+
+	void takeSnapshot() {
+		std::map<MotorID, LayoutType> knownMotors;
+		{
+			auto g = std::lock_guard(motorsMutex);
+			knownMotors = motors;
+		}
+		auto timeout = std::chrono::microseconds{g_timeout};
+		RegisterCache fresh{std::chrono::hours{1}};
+		RegisterCache* source = cache ? cache : &fresh;
+		auto isFresh = [&]{
+			return std::all_of(begin(knownMotors), end(knownMotors), [&](auto const& p) {
+				auto [baseRegister, length] = getFullLayoutWindow(p.second);
+				return source->get(p.first, baseRegister, length).has_value();
+			});
+		};
+		if (not isFresh()) {
+			auto io = arbiter.foregroundIO();
+			refreshCache(usb2dyn, *source, knownMotors, timeout);
+		}
+
+		snapshot.clear();
+		for (auto const& [motor, layout] : knownMotors) {
+			auto [baseRegister, length] = getFullLayoutWindow(layout);
+			auto content = source->get(motor, baseRegister, length).value_or(Parameter(length));
+			snapshot.push_back(std::byte{motor});
+			snapshot.push_back(std::byte(layout));
+			snapshot.push_back(std::byte(length & 0xff));
+			snapshot.push_back(std::byte((length >> 8) & 0xff));
+			snapshot.insert(snapshot.end(), content.begin(), content.end());
+		}
+	}
+
+	USB2Dynamixel &usb2dyn;
+	RegisterCache* cache;
+	BusArbiter& arbiter;
+	std::mutex& motorsMutex;
+	std::map<MotorID, LayoutType> const& motors;
+
+	std::mutex snapshotMutex;
+	Parameter snapshot;
+};
+
 void runFuse() {
 	auto timeout = std::chrono::microseconds{*g_timeout};
 	auto usb2dyn = USB2Dynamixel(*g_baudrate, *g_device, *g_protocolVersion);
@@ -150,45 +847,198 @@ void runFuse() {
 		std::iota(begin(range), end(range), 0);
 	}
 
-	simplyfuse::FuseFS fuseFS{*mountPoint};
-	std::map<MotorID, std::vector<std::unique_ptr<simplyfuse::FuseFile>>> files;
+	simplyfuse::FuseFS fuseFS{*mountPoint, *optWorkers};
+	std::map<MotorID, std::unique_ptr<MotorFiles>> files;
+
+	auto cacheInterval = std::chrono::milliseconds{*optCacheMs};
+	auto maxStaleness  = optMaxStale ? std::chrono::milliseconds{*optMaxStale} : 2 * cacheInterval;
+	std::unique_ptr<RegisterCache> cache;
+	if (cacheInterval.count() > 0) {
+		cache = std::make_unique<RegisterCache>(maxStaleness);
+	}
+	std::mutex motorsMutex;
+	std::map<MotorID, LayoutType> motors;
+
+	std::optional<std::chrono::milliseconds> writeWindow;
+	if (*optWriteWin > 0 and not optHoldWrite) {
+		writeWindow = std::chrono::milliseconds{*optWriteWin};
+	}
+	BusArbiter arbiter;
+	WriteBatcher writer{usb2dyn, cache.get(), arbiter, writeWindow.has_value() or optHoldWrite, writeWindow};
+	auto commitFile = CommitFile(writer);
 
 	auto detectAndHandleMotor = [&](MotorID motor) {
 		auto [layout, modelNumber] = detectMotor(MotorID(motor), usb2dyn, timeout);
 		if (modelNumber == 0) {
 			return false;
 		}
-		std::vector<std::unique_ptr<simplyfuse::FuseFile>> newFiles;
+		{
+			// a known motor keeps its files, replacing them would break open handles and requests in flight
+			auto g = std::lock_guard(motorsMutex);
+			auto known = files.find(motor);
+			if (known != files.end() and known->second and known->second->modelNumber == modelNumber) {
+				return true;
+			}
+		}
+		std::unique_ptr<MotorFiles> newFiles;
 		meta::forAllLayoutTypes([&](auto const& info) {
 			using Info = std::decay_t<decltype(info)>;
 			if (layout == Info::Type) {
-				newFiles= registerMotor<Info::Type>(motor, modelNumber,usb2dyn, fuseFS);
+				newFiles = registerMotor<Info::Type>(MotorContext{motor, usb2dyn, cache.get(), writer, arbiter}, modelNumber, fuseFS);
 			}
 		});
+		if (not newFiles) {
+			// no layout for this model: the files of a motor previously known under this id have to go, too
+			fuseFS.rmdir("/" + std::to_string(motor));
+			if (cache) {
+				auto g = std::lock_guard(cache->mutex);
+				cache->entries.erase(motor);
+			}
+		}
+		auto g = std::lock_guard(motorsMutex);
 		files[motor] = std::move(newFiles);
+		if (layout != LayoutType::None) {
+			motors[motor] = layout;
+		} else {
+			motors.erase(motor);
+		}
 		return true;
 	};
 
-	auto detectSingleMotor = PingFile(detectAndHandleMotor);
-	auto detectAllMotors  = PingFile([=](int v) {
+	auto allMotorsFile = AllMotorsFile(usb2dyn, cache.get(), arbiter, motorsMutex, motors);
+
+	fuseFS.registerFile("/all_motors.bin", allMotorsFile);
+	fuseFS.registerFile("/commit", commitFile);
+
+	DetectionJob detection{detectAndHandleMotor, arbiter};
+	auto detectSingleMotor = PingFile([&](MotorID motor) {
+		detection.scan({motor});
+		return true;
+	});
+	auto detectAllMotors   = PingFile([&](int v) {
+		if (v == 0) {
+			detection.cancel();
+			return true;
+		}
 		if (v != 1) {
 			return false;
 		}
-		for (int i{0}; i < 0xfe; ++i) {
-			detectAndHandleMotor(i);
-		}
+		std::vector<MotorID> all(0xfe);
+		std::iota(begin(all), end(all), 0);
+		detection.scan(all);
 		return true;
 	});
+	auto detectStatus = DetectionStatusFile(detection);
 
 	fuseFS.registerFile("/detect_motor", detectSingleMotor);
 	fuseFS.registerFile("/detect_all_motors", detectAllMotors);
-	auto future = std::async(std::launch::async, [&]{
-		// ping all motors
-		for (auto motor : range) {
-			if (terminateFlag) {
-				break;
+	fuseFS.registerFile("/detect_status", detectStatus);
+
+	auto statsFile = StatsFile(usb2dyn);
+	fuseFS.registerFile("/stats", statsFile);
+
+	// ping all motors in the background
+	detection.scan(std::vector<MotorID>(begin(range), end(range)));
+
+	// wake up everyone polling on files of motor whose registers differ between before and after (motorsMutex must be held)
+	auto notifyChangedRegisters = [&](MotorID motor, int baseRegister, Parameter const& before, Parameter const& after) {
+		auto motorFiles = files.find(motor);
+		if (before == after or before.size() != after.size() or motorFiles == files.end() or not motorFiles->second) {
+			return false;
+		}
+		auto notifyIfChanged = [&](RegisterBackedFile& file) {
+			auto [reg, length] = file.registerRange();
+			int offset = reg - baseRegister;
+			if (offset < 0 or offset + length > before.size()) {
+				return;
+			}
+			auto first = std::next(before.begin(), offset);
+			if (not std::equal(first, std::next(first, length), std::next(after.begin(), offset))) {
+				fuseFS.notifyChanged(file);
+			}
+		};
+		notifyIfChanged(motorFiles->second->rawFile);
+		for (auto& file : motorFiles->second->registerFiles) {
+			notifyIfChanged(file);
+		}
+		return true;
+	};
+
+	// notify about the changes of the last refresh
+	auto notifyChangedFiles = [&](std::map<MotorID, RegisterCache::Entry> const& previous) {
+		bool anyChange {false};
+		auto g = std::lock_guard(motorsMutex);
+		for (auto const& [motor, oldEntry] : previous) {
+			auto newData = cache->get(motor, oldEntry.baseRegister, oldEntry.data.size());
+			if (newData and notifyChangedRegisters(motor, oldEntry.baseRegister, oldEntry.data, *newData)) {
+				anyChange = true;
+			}
+		}
+		if (anyChange) {
+			fuseFS.notifyChanged(allMotorsFile);
+		}
+	};
+
+	// and about changes made by writes and reads through the filesystem
+	if (cache) {
+		cache->onPatch = [&](MotorID motor, int baseRegister, Parameter const& before, Parameter const& after) {
+			auto g = std::lock_guard(motorsMutex);
+			if (notifyChangedRegisters(motor, baseRegister, before, after)) {
+				fuseFS.notifyChanged(allMotorsFile);
+			}
+		};
+	}
+
+	auto poller = std::async(std::launch::async, [&]{
+		if (not cache) {
+			return;
+		}
+		auto next = std::chrono::steady_clock::now();
+		while (not terminateFlag) {
+			std::map<MotorID, LayoutType> knownMotors;
+			{
+				auto g = std::lock_guard(motorsMutex);
+				knownMotors = motors;
+			}
+			decltype(cache->entries) previous;
+			{
+				auto g = std::lock_guard(cache->mutex);
+				previous = cache->entries;
+			}
+			{
+				auto io = arbiter.foregroundIO();
+				refreshCache(usb2dyn, *cache, knownMotors, timeout);
+			}
+			notifyChangedFiles(previous);
+			// refreshes that take longer than the interval would run back to back and starve the detection job otherwise
+			arbiter.yield(std::max(cacheInterval, std::chrono::milliseconds{1}));
+			next = std::max(next + cacheInterval, std::chrono::steady_clock::now());
+			std::this_thread::sleep_until(next);
+		}
+	});
+
+	auto writeFlusher = std::async(std::launch::async, [&]{
+		if (not writeWindow) {
+			return;
+		}
+		while (not terminateFlag) {
+			writer.flushWhenDue();
+		}
+	});
+
+	auto statsDumper = std::async(std::launch::async, [&]{
+		auto interval = std::chrono::seconds{*optStatsSec};
+		if (interval.count() <= 0) {
+			return;
+		}
+		auto next = std::chrono::steady_clock::now() + interval;
+		while (not terminateFlag) {
+			if (std::chrono::steady_clock::now() >= next) {
+				usb2dyn.getStatistics().print(std::cout);
+				std::cout << std::flush;
+				next += interval;
 			}
-			detectAndHandleMotor(motor);
+			std::this_thread::sleep_for(std::chrono::milliseconds{100});
 		}
 	});
 
@@ -204,6 +1054,9 @@ void runFuse() {
 	while (not terminateFlag) {
 		epoll.work(1);
 	}
+	// the files are destroyed before fuseFS, no worker may call into them anymore
+	fuseFS.stop();
+	writer.flush();
 }
 
 }
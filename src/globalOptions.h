@@ -13,6 +13,7 @@ inline auto g_device          = sargp::Parameter<std::string>(getDefaultSerialPo
 inline auto g_id              = sargp::Parameter<int>(0, "id", "the target Id (values: 0x00 - 0xfd)");
 inline auto g_baudrate        = sargp::Parameter<int>(1000000, "baudrate", "baudrate to use (e.g.: 1m)", {}, &listTypicalBaudrates);
 inline auto g_timeout         = sargp::Parameter<int>(10000, "timeout", "timeout in us");
+inline auto g_capture         = sargp::Parameter<std::string>("", "capture", "record all bytes sent to and received from the bus into this file (read it with \"decode\")");
 inline auto g_protocolVersion = sargp::Choice<dynamixel::Protocol>(dynamixel::Protocol::V1, "protocol_version", {
     {"1", dynamixel::Protocol::V1},
     {"2", dynamixel::Protocol::V2}
@@ -69,7 +69,7 @@ void runInteract() {
 	try {
 		auto timeout = std::chrono::microseconds{optTimeout};
 
-		auto usb2dyn = dynamixel::USB2Dynamixel(g_baudrate, g_device.get(), dynamixel::Protocol(g_protocolVersion.get()));
+		auto usb2dyn = dynamixel::USB2Dynamixel(*g_baudrate, *g_device, *g_protocolVersion);
 
 		int layoutVersion = checkMotorVersion(g_id, usb2dyn, timeout);
 
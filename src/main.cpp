@@ -1,6 +1,10 @@
 #include <sargparse/ArgumentParsing.h>
 #include <sargparse/Parameter.h>
+#include "globalOptions.h"
+#include "usb2dynamixel/WireCapture.h"
+#include "usb2dynamixel/file_io.h"
 #include <iostream>
+#include <memory>
 
 namespace {
 
@@ -33,6 +37,7 @@ int main(int argc, char** argv)
 		return 0;
 	}
 
+	std::unique_ptr<dynamixel::capture::Writer> capture;
 	try {
 		// pass everything except the name of the application
 		sargp::parseArguments(argc-1, argv+1);
@@ -42,9 +47,14 @@ int main(int argc, char** argv)
 			std::cout << sargp::generateHelpString(std::regex{".*" + printHelp->value_or("") + ".*"});
 			return 0;
 		}
+		if (not g_capture->empty()) {
+			capture = std::make_unique<dynamixel::capture::Writer>(*g_capture, *g_baudrate, int(*g_protocolVersion));
+			dynamixel::file_io::setCapture(capture.get());
+		}
 		sargp::callCommands();
 	} catch (std::exception const& e) {
 		std::cerr << "exception: " << TERM_RED << e.what() << TERM_RESET "\n";
 	}
+	dynamixel::file_io::setCapture(nullptr);
 	return 0;
 }
@@ -70,7 +70,7 @@ void printDetailInfoTable(meta::MotorInfo const& data) {
 			} else {
 				std::cout << "      - |";
 			}
-			if (convert.toMotor and convert.fromMotor and optDefault) {
+			if (convert and optDefault) {
 				std::cout.width(9);
 				std::cout << convert.fromMotor(optDefault.value());
 				std::cout.width(3);
@@ -0,0 +1,124 @@
+#include "usb2dynamixel/USB2Dynamixel.h"
+#include "globalOptions.h"
+
+#include "commonTasks.h"
+#include "Trajectory.h"
+
+#include "simplyfile/Timer.h"
+
+#include <atomic>
+#include <csignal>
+#include <iostream>
+
+namespace {
+
+void runPlay();
+auto playCmd    = sargp::Command{"play", "play a trajectory (binary or CSV, see README) with sync writes at a fixed rate", runPlay};
+auto optFile    = playCmd.Parameter<std::string>("", "file", "the trajectory to play");
+auto optCache   = playCmd.Parameter<std::string>("", "cache", "where a CSV trajectory is converted to (default: <file>.bin)");
+auto optRate    = playCmd.Parameter<int>(100, "rate_hz", "set-points per second sent to the motors");
+auto optSpeed   = playCmd.Parameter<double>(1., "speed", "playback speed factor");
+auto optLoop    = playCmd.Flag("loop", "start over at the end of the trajectory");
+auto optConvert = playCmd.Flag("convert_only", "only convert the CSV trajectory into its binary cache");
+
+using namespace dynamixel;
+
+std::atomic<bool> terminateFlag {false};
+
+// all channels that are written with one sync write
+struct WriteGroup {
+	int                                          baseRegister;
+	std::size_t                                  width;
+	std::vector<std::pair<std::size_t, MotorID>> channels; // channel index, motor
+	std::map<MotorID, Parameter>                 params;   // reused every tick
+};
+
+auto buildWriteGroups(std::vector<trajectory::Channel> const& channels, USB2Dynamixel& usb2dyn, std::chrono::microseconds timeout) -> std::vector<WriteGroup> {
+	std::map<MotorID, LayoutType> layouts;
+	for (auto const& channel : channels) {
+		if (layouts.count(channel.motor)) {
+			continue;
+		}
+		auto [layout, modelNumber] = detectMotor(channel.motor, usb2dyn, timeout);
+		if (layout == LayoutType::None) {
+			throw std::runtime_error("motor " + std::to_string(channel.motor) + " of the trajectory was not found");
+		}
+		layouts[channel.motor] = layout;
+	}
+
+	std::vector<WriteGroup> groups;
+	for (std::size_t c{0}; c < channels.size(); ++c) {
+		auto motor  = channels[c].motor;
+		auto layout = layouts.at(motor);
+		int  reg    = channels[c].baseRegister == trajectory::DefaultRegister ? findRegister(layout, "Goal Position") : channels[c].baseRegister;
+		std::size_t width = describeRegisters(layout, {reg}).front().width;
+
+		auto iter = std::find_if(begin(groups), end(groups), [&](auto const& g) { return g.baseRegister == reg and g.width == width; });
+		if (iter == end(groups)) {
+			groups.push_back(WriteGroup{reg, width, {}, {}});
+			iter = std::prev(end(groups));
+		}
+		iter->channels.emplace_back(c, motor);
+		iter->params[motor].resize(width);
+	}
+	return groups;
+}
+
+void runPlay() {
+	if (optFile->empty()) {
+		throw std::runtime_error("must specify a trajectory file");
+	}
+	if (optConvert) {
+		trajectory::convertCSV(*optFile, optCache->empty() ? *optFile + ".bin" : *optCache);
+		return;
+	}
+	auto motion = trajectory::MappedTrajectory{*optFile, *optCache};
+	if (motion.sampleCount() == 0) {
+		throw std::runtime_error("trajectory " + *optFile + " has no samples");
+	}
+
+	auto timeout = std::chrono::microseconds{*g_timeout};
+	auto usb2dyn = USB2Dynamixel(*g_baudrate, *g_device, *g_protocolVersion);
+	auto groups  = buildWriteGroups(motion.channels(), usb2dyn, timeout);
+
+	auto sigHandler = [](int){ terminateFlag = true; };
+	std::signal(SIGINT, sigHandler);
+	std::signal(SIGTERM, sigHandler);
+
+	std::cout << "playing " << motion.sampleCount() << " samples of " << motion.channels().size() << " channels ("
+		<< std::chrono::duration_cast<std::chrono::milliseconds>(motion.duration()).count() << "ms)\n";
+
+	std::vector<int32_t> values(motion.channels().size());
+	std::size_t cursor {0};
+	auto period = std::chrono::nanoseconds{std::chrono::seconds{1}} / std::max(1, *optRate);
+	auto timer  = simplyfile::Timer{period, false, 0};
+	auto start  = std::chrono::steady_clock::now();
+	while (not terminateFlag) {
+		auto t = std::chrono::duration_cast<std::chrono::nanoseconds>((std::chrono::steady_clock::now() - start) * *optSpeed);
+		if (t > motion.duration()) {
+			if (not optLoop) {
+				t = motion.duration();
+				terminateFlag = true; // send the last set-point and stop
+			} else {
+				start  = std::chrono::steady_clock::now();
+				t      = std::chrono::nanoseconds{0};
+				cursor = 0;
+			}
+		}
+		motion.interpolate(t, cursor, values.data());
+		for (auto& group : groups) {
+			for (auto const& [channel, motor] : group.channels) {
+				auto& buffer = group.params[motor];
+				for (std::size_t i{0}; i < group.width; ++i) {
+					buffer[i] = std::byte((values[channel] >> (8*i)) & 0xff);
+				}
+			}
+			usb2dyn.sync_write(group.params, group.baseRegister);
+		}
+		if (not terminateFlag) {
+			timer.getElapsed();
+		}
+	}
+}
+
+}
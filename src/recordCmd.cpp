@@ -0,0 +1,75 @@
+#include "usb2dynamixel/USB2Dynamixel.h"
+#include "usb2dynamixel/TelemetryLog.h"
+#include "usb2dynamixel/TelemetryPoller.h"
+#include "globalOptions.h"
+
+#include "commonTasks.h"
+
+#include <atomic>
+#include <csignal>
+#include <iostream>
+
+namespace {
+
+void runRecord();
+auto recordCmd    = sargp::Command{"record", "poll registers of all motors at a fixed rate and record them into a compact telemetry log", runRecord};
+auto optFile      = recordCmd.Parameter<std::string>("", "file", "the log to write");
+auto optIDs       = recordCmd.Parameter<std::set<int>>({}, "ids", "motors to record (default: all detected motors)");
+auto optRegisters = recordCmd.Parameter<std::vector<int>>({}, "registers", "registers to record (default: present position)");
+auto optRate      = recordCmd.Parameter<int>(1000, "rate_hz", "frames per second");
+auto optDuration  = recordCmd.Parameter<double>(0., "duration_s", "stop recording after this many seconds (0: until interrupted)");
+auto optKeyframe  = recordCmd.Parameter<int>(1000, "keyframe_interval", "frames per block, every block starts with a keyframe and gets an index entry");
+auto optBufferKB  = recordCmd.Parameter<int>(1024, "buffer_kb", "size of the chunks written to disk");
+
+using namespace dynamixel;
+
+std::atomic<bool> terminateFlag {false};
+
+void runRecord() {
+	if (optFile->empty()) {
+		throw std::runtime_error("must specify a log file");
+	}
+	auto timeout = std::chrono::microseconds{*g_timeout};
+	auto usb2dyn = USB2Dynamixel(*g_baudrate, *g_device, *g_protocolVersion);
+
+	auto [layoutType, motors] = detectMotorsOfOneLayout(*optIDs, usb2dyn, timeout);
+	auto registers = *optRegisters;
+	if (registers.empty()) {
+		registers.push_back(findRegister(layoutType, "Present Position"));
+	}
+	auto columns = describeRegisters(layoutType, registers);
+	auto log     = telemetry::LogWriter{*optFile, columns, motors, std::size_t(std::max(1, *optKeyframe)), std::size_t(std::max(1, *optBufferKB)) * 1024};
+
+	auto sigHandler = [](int){ terminateFlag = true; };
+	std::signal(SIGINT, sigHandler);
+	std::signal(SIGTERM, sigHandler);
+
+	std::cout << "recording " << motors.size() << " motors into " << *optFile << "\n";
+	auto period   = std::chrono::nanoseconds{std::chrono::seconds{1}} / std::max(1, *optRate);
+	auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::duration<double>{*optDuration});
+	std::optional<std::chrono::nanoseconds> start;
+	auto nextReport = std::chrono::nanoseconds{0};
+
+	auto poller = TelemetryPoller{usb2dyn, motors, TelemetryFrame{columns}, period, timeout};
+	poller.run([&](std::chrono::nanoseconds timestamp, TelemetryFrame const& frame) {
+		log.append(timestamp, frame);
+		if (not start) {
+			start      = timestamp;
+			nextReport = timestamp + std::chrono::seconds{1};
+		}
+		auto elapsed = timestamp - *start;
+		if (timestamp >= nextReport) {
+			nextReport += std::chrono::seconds{1};
+			auto minutes = std::chrono::duration<double, std::ratio<60>>{elapsed}.count();
+			std::cerr << log.getFramesWritten() << " frames, " << log.getBytesWritten() / 1024 << " KiB (" << int(log.getBytesWritten() / 1024 / minutes) << " KiB/min), " << poller.getOverruns() << " overruns\n";
+		}
+		if (duration.count() > 0 and elapsed >= duration) {
+			terminateFlag = true;
+		}
+	}, terminateFlag);
+
+	log.close();
+	std::cout << "recorded " << log.getFramesWritten() << " frames, " << log.getBytesWritten() << " bytes\n";
+}
+
+}
@@ -0,0 +1,96 @@
+#include "usb2dynamixel/TelemetryLog.h"
+#include "usb2dynamixel/TelemetryRing.h"
+#include "globalOptions.h"
+
+#include <atomic>
+#include <csignal>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+
+namespace {
+
+void runReplay();
+auto replayCmd    = sargp::Command{"replay", "replay a log written by \"record\"", runReplay};
+auto optFile      = replayCmd.Parameter<std::string>("", "file", "the log to replay");
+auto optFrom      = replayCmd.Parameter<double>(0., "from_s", "start at this many seconds after the beginning of the log");
+auto optTo        = replayCmd.Parameter<double>(-1., "to_s", "stop at this many seconds after the beginning of the log (default: end of the log)");
+auto optSpeed     = replayCmd.Parameter<double>(1., "speed", "replay speed factor (0: as fast as possible)");
+auto optRegisters = replayCmd.Parameter<std::vector<int>>({}, "registers", "only decode these registers (default: all registers of the log)");
+auto optShmName   = replayCmd.Parameter<std::string>("", "shm_name", "publish the frames into this shared memory ring (like \"telemetry\") instead of printing them");
+auto optInfo      = replayCmd.Flag("info", "only print information about the log");
+
+using namespace dynamixel;
+
+std::atomic<bool> terminateFlag {false};
+
+void printInfo(telemetry::LogReader const& reader) {
+	auto duration = std::chrono::duration<double>{reader.end() - reader.begin()}.count();
+	std::cout << "motors:";
+	for (auto motor : reader.motors()) {
+		std::cout << " " << int(motor);
+	}
+	std::cout << "\nregisters:";
+	for (auto const& column : reader.columns()) {
+		std::cout << " " << column.baseRegister << " (" << int(column.width) << (column.isSigned ? " bytes signed)" : " bytes)");
+	}
+	std::cout << "\nframes: " << reader.frameCount() << " in " << reader.index().size() << " blocks, " << duration << "s\n";
+}
+
+void runReplay() {
+	if (optFile->empty()) {
+		throw std::runtime_error("must specify a log file");
+	}
+	auto reader = telemetry::LogReader{*optFile};
+	if (optInfo) {
+		printInfo(reader);
+		return;
+	}
+
+	auto seconds = [](double s) {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::duration<double>{s});
+	};
+	auto from = reader.begin() + seconds(*optFrom);
+	auto to   = *optTo < 0 ? reader.end() : reader.begin() + seconds(*optTo);
+
+	auto sigHandler = [](int){ terminateFlag = true; };
+	std::signal(SIGINT, sigHandler);
+	std::signal(SIGTERM, sigHandler);
+
+	FrameCallback callback;
+	std::unique_ptr<telemetry::RingWriter> ring;
+	std::vector<int32_t const*> columnPtrs;
+	if (not optShmName->empty()) {
+		std::vector<telemetry::ColumnInfo> columnInfos;
+		for (auto const& d : reader.columns()) {
+			if (optRegisters->empty() or std::find(optRegisters->begin(), optRegisters->end(), d.baseRegister) != optRegisters->end()) {
+				columnInfos.push_back({d.baseRegister, d.width, d.isSigned, {}});
+			}
+		}
+		ring = std::make_unique<telemetry::RingWriter>(*optShmName, columnInfos, reader.motors().size(), 64);
+		callback = [&](std::chrono::nanoseconds timestamp, TelemetryFrame const& frame) {
+			columnPtrs.resize(frame.columns.size());
+			for (std::size_t c{0}; c < frame.columns.size(); ++c) {
+				columnPtrs[c] = frame.columns[c].values.data();
+			}
+			ring->publish(frame.motors.data(), frame.motors.size(), columnPtrs.data(), timestamp.count());
+		};
+	} else {
+		std::cout << std::fixed << std::setprecision(6);
+		callback = [&](std::chrono::nanoseconds timestamp, TelemetryFrame const& frame) {
+			std::cout << std::chrono::duration<double>{timestamp - reader.begin()}.count();
+			for (std::size_t m{0}; m < frame.motors.size(); ++m) {
+				std::cout << " " << int(frame.motors[m]);
+				char sep = ':';
+				for (auto const& column : frame.columns) {
+					std::cout << sep << column.values[m];
+					sep = ',';
+				}
+			}
+			std::cout << "\n";
+		};
+	}
+	reader.replay(from, to, *optSpeed, *optRegisters, callback, terminateFlag);
+}
+
+}
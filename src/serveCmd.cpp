@@ -0,0 +1,272 @@
+#include "usb2dynamixel/USB2Dynamixel.h"
+#include "usb2dynamixel/Remote.h"
+#include "globalOptions.h"
+
+#include "simplyfile/Epoll.h"
+#include "simplyfile/socket/Socket.h"
+
+#include <atomic>
+#include <csignal>
+#include <iostream>
+#include <map>
+#include <thread>
+
+#include <sys/socket.h>
+
+namespace {
+
+void runServe();
+auto serveCmd   = sargp::Command{"serve", "own the bus and let other inspexel instances use it through a unix socket", runServe};
+auto optSocket  = serveCmd.Parameter<std::string>("", "socket", "path of the unix socket (default: /tmp/inspexel-<device name>.sock)");
+auto optMergeUs = serveCmd.Parameter<int>(0, "merge_window_us", "wait this long for requests of other clients before accessing the bus, so more of them can be merged");
+auto optStatsSec = serveCmd.Parameter<int>(0, "stats_interval", "print the bus statistics every stats_interval seconds (0 disables it)");
+
+using namespace dynamixel;
+using remote::Op;
+
+std::atomic<bool> terminateFlag {false};
+
+struct Pending {
+	int              fd;
+	uint64_t         session;  // fds are reused, the session id identifies the client
+	remote::Request  request;
+	remote::Response response;
+	bool             done {false};
+};
+
+void executeSingle(USB2Dynamixel& usb2dyn, Pending& p) {
+	auto const& req = p.request;
+	auto& res = p.response;
+	switch (req.op) {
+	case Op::Hello:
+		res.protocol = uint8_t(usb2dyn.getProtocol());
+		res.baudrate = uint32_t(usb2dyn.getBaudrate());
+		break;
+	case Op::Ping:
+		res.motor = usb2dyn.ping(req.motor, req.timeout) ? req.motor : MotorIDInvalid;
+		break;
+	case Op::Read:
+		std::tie(res.timeout, res.motor, res.errorCode, res.data) = usb2dyn.read(req.motor, req.baseRegister, req.length, req.timeout);
+		break;
+	case Op::BulkRead:
+		res.reads = usb2dyn.bulk_read(req.reads, req.timeout);
+		break;
+	case Op::Write:
+		usb2dyn.write(req.motor, req.baseRegister, req.data);
+		break;
+	case Op::WriteRead:
+		std::tie(res.timeout, res.motor, res.errorCode, res.data) = usb2dyn.writeRead(req.motor, req.baseRegister, req.data, req.timeout);
+		break;
+	case Op::SyncWrite: {
+		std::map<MotorID, Parameter> motorParams;
+		for (auto const& [motor, baseRegister, data] : req.writes) {
+			motorParams[motor] = data;
+		}
+		usb2dyn.sync_write(motorParams, req.baseRegister);
+	} break;
+	case Op::BulkWrite:
+		usb2dyn.bulk_write(req.writes);
+		break;
+	case Op::RegWrite:
+		usb2dyn.reg_write(req.motor, req.baseRegister, req.data, req.timeout);
+		break;
+	case Op::SynchronizedWrite:
+		usb2dyn.synchronized_write(req.writes, req.timeout);
+		break;
+	case Op::Action:
+		usb2dyn.action(req.motor);
+		break;
+	case Op::Reset:
+		usb2dyn.reset(req.motor);
+		break;
+	case Op::Reboot:
+		usb2dyn.reboot(req.motor);
+		break;
+	default:
+		throw std::runtime_error("unknown request " + std::to_string(int(req.op)));
+	}
+}
+
+// all single register reads of the batch (of distinct motors) as one bulk read
+// motors that did not answer within the bulk read are asked again one by one
+void executeMergedReads(USB2Dynamixel& usb2dyn, std::vector<Pending*> const& reads) {
+	std::vector<std::tuple<MotorID, int, size_t>> request;
+	std::chrono::microseconds timeout {0};
+	for (auto p : reads) {
+		request.emplace_back(p->request.motor, p->request.baseRegister, p->request.length);
+		timeout = std::max(timeout, p->request.timeout);
+	}
+	auto response = usb2dyn.bulk_read(request, timeout);
+	for (auto p : reads) {
+		auto it = std::find_if(begin(response), end(response), [&](auto const& r) { return std::get<0>(r) == p->request.motor; });
+		if (it == end(response)) {
+			executeSingle(usb2dyn, *p);
+		} else {
+			p->response.motor     = std::get<0>(*it);
+			p->response.errorCode = std::get<2>(*it);
+			p->response.data      = std::get<3>(*it);
+		}
+		p->done = true;
+	}
+}
+
+/**
+ * executes the requests of one batch (in arrival order)
+ * requests of different clients are merged where the bus allows it:
+ * - single reads of distinct motors become one bulk read (protocol 2 only, not all protocol 1 motors support BULK_READ)
+ * - writes of the same register and length to distinct motors become one sync write
+ */
+void execute(USB2Dynamixel& usb2dyn, std::vector<Pending>& batch) {
+	auto isMergeableRead = [&](Pending const& p) {
+		return not p.done and p.request.op == Op::Read and usb2dyn.getProtocol() == Protocol::V2;
+	};
+	for (auto& p : batch) {
+		if (p.done) {
+			continue;
+		}
+		try {
+			if (isMergeableRead(p)) {
+				std::vector<Pending*> group;
+				std::set<MotorID> motors;
+				for (auto& other : batch) {
+					if (isMergeableRead(other) and motors.insert(other.request.motor).second) {
+						group.push_back(&other);
+					}
+				}
+				if (group.size() > 1) {
+					executeMergedReads(usb2dyn, group);
+					continue;
+				}
+			} else if (p.request.op == Op::Write) {
+				std::vector<Pending*> group;
+				std::map<MotorID, Parameter> motorParams;
+				for (auto& other : batch) {
+					auto const& req = other.request;
+					if (not other.done and req.op == Op::Write and req.baseRegister == p.request.baseRegister and req.data.size() == p.request.data.size()
+						and motorParams.emplace(req.motor, req.data).second) {
+						group.push_back(&other);
+					}
+				}
+				if (group.size() > 1) {
+					usb2dyn.sync_write(motorParams, p.request.baseRegister);
+					for (auto other : group) {
+						other->done = true;
+					}
+					continue;
+				}
+			}
+			executeSingle(usb2dyn, p);
+		} catch (std::exception const& e) {
+			p.response.error = e.what();
+		}
+		p.done = true;
+	}
+}
+
+struct Session {
+	uint64_t                 id;
+	simplyfile::ClientSocket socket;
+	Parameter                buffer;
+};
+
+void runServe() {
+	auto path    = optSocket ? *optSocket : remote::socketPath(*g_device);
+	auto usb2dyn = USB2Dynamixel(*g_baudrate, *g_device, *g_protocolVersion, false);
+
+	simplyfile::ServerSocket server{simplyfile::makeUnixDomainHost(path)};
+	server.listen();
+	std::cout << "serving " << *g_device << " on " << path << "\n";
+
+	simplyfile::Epoll epoll;
+	std::map<int, Session> sessions;
+	uint64_t nextSessionID {0};
+	std::vector<Pending> batch;
+
+	auto closeSession = [&](int fd) {
+		epoll.rmFD(fd, false);
+		sessions.erase(fd);
+	};
+
+	auto readClient = [&](int fd) {
+		auto& session = sessions.at(fd);
+		while (true) {
+			std::byte chunk[4096];
+			auto n = ::recv(session.socket, chunk, sizeof(chunk), MSG_DONTWAIT);
+			if (n < 0 and (errno == EAGAIN or errno == EWOULDBLOCK)) {
+				break;
+			}
+			if (n < 0 and errno == EINTR) {
+				continue;
+			}
+			if (n <= 0) {
+				closeSession(fd);
+				return;
+			}
+			session.buffer.insert(session.buffer.end(), chunk, chunk + n);
+		}
+		for (auto& message : remote::extractMessages(session.buffer)) {
+			Pending p{fd, session.id, {}, {}};
+			try {
+				p.request = remote::decodeRequest(message);
+			} catch (std::exception const& e) {
+				p.response.error = e.what();
+				p.done = true;
+			}
+			batch.emplace_back(std::move(p));
+		}
+	};
+
+	epoll.addFD(server, [&](int) {
+		auto socket = server.accept();
+		int fd = socket;
+		sessions.emplace(fd, Session{nextSessionID++, std::move(socket), {}});
+		epoll.addFD(fd, [&, fd](int) { readClient(fd); }, EPOLLIN, "client");
+	}, EPOLLIN, "server");
+
+	auto sigHandler = [](int){ terminateFlag = true; };
+	std::signal(SIGINT, sigHandler);
+	std::signal(SIGTERM, sigHandler);
+
+	auto statsInterval = std::chrono::seconds{*optStatsSec};
+	auto nextStats     = std::chrono::steady_clock::now() + statsInterval;
+	while (not terminateFlag) {
+		epoll.work(32, 100);
+		if (statsInterval.count() > 0 and std::chrono::steady_clock::now() >= nextStats) {
+			usb2dyn.getStatistics().print(std::cout);
+			std::cout << std::flush;
+			nextStats += statsInterval;
+		}
+		if (batch.empty()) {
+			continue;
+		}
+		if (*optMergeUs > 0) {
+			std::this_thread::sleep_for(std::chrono::microseconds{*optMergeUs});
+			epoll.work(32, 0);
+		}
+		execute(usb2dyn, batch);
+		for (auto const& p : batch) {
+			auto it = sessions.find(p.fd);
+			if (it == sessions.end() or it->second.id != p.session) {
+				continue;
+			}
+			auto txBuf = remote::encode(p.response);
+			std::size_t sent {0};
+			while (sent < txBuf.size()) {
+				auto n = ::send(it->second.socket, txBuf.data() + sent, txBuf.size() - sent, MSG_NOSIGNAL);
+				if (n < 0 and errno == EINTR) {
+					continue;
+				}
+				if (n <= 0) {
+					break;
+				}
+				sent += n;
+			}
+			if (sent < txBuf.size()) {
+				closeSession(p.fd);
+			}
+		}
+		batch.clear();
+	}
+}
+
+}
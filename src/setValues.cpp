@@ -59,6 +59,7 @@ void runSetRegister() {
 	if (not reg) throw std::runtime_error("target register has to be specified!");
 	if (not values) throw std::runtime_error("values to be written to the register have to be specified!");
 
+	auto usb2dyn = dynamixel::USB2Dynamixel(*g_baudrate, *g_device, *g_protocolVersion);
 	auto f = [&](int id) {
 		std::cout << "set register " << reg << " of motor " << id << " to";
 		for (uint8_t v : std::vector<uint8_t>(values)) {
@@ -69,7 +70,6 @@ void runSetRegister() {
 		for (auto x : values.get()) {
 			txBuf.push_back(std::byte{x});
 		}
-		auto usb2dyn = dynamixel::USB2Dynamixel(g_baudrate, g_device.get(), dynamixel::Protocol(g_protocolVersion.get()));
 		usb2dyn.write(id, int(reg), txBuf);
 	};
 	if (g_id) {
@@ -92,7 +92,7 @@ void runGetValue() {
 	if (not g_id) throw std::runtime_error("need to specify the target g_id!");
 	if (not read_reg) throw std::runtime_error("target angle has to be specified!");
 
-	auto usb2dyn = dynamixel::USB2Dynamixel(g_baudrate, g_device.get(), dynamixel::Protocol(g_protocolVersion.get()));
+	auto usb2dyn = dynamixel::USB2Dynamixel(*g_baudrate, *g_device, *g_protocolVersion);
 	auto [timeoutFlag, valid, errorCode, rxBuf] = usb2dyn.read(g_id, read_reg, count, std::chrono::microseconds{timeout});
 	if (valid) {
 		std::cout << "motor " << static_cast<int>(g_id) << "\n";
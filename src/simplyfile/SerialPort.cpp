@@ -47,13 +47,14 @@ SerialPort::SerialPort(std::string const& name, int baudrate)
 	}
 	struct serial_struct serial;
 	bzero(&serial, sizeof(serial));
+	// not every tty is a serial driver (e.g. the pty of "inspexel simulate"), those run without the low latency flag
 	if (0 > ioctl(iFace, TIOCGSERIAL, &serial)) {
-		throw std::runtime_error("TIOCGSERIAL " +std::string(strerror(errno)));
-	}
-
-	serial.flags |= ASYNC_LOW_LATENCY;  /* enable low latency  */
-	if (0 > ioctl(iFace, TIOCSSERIAL, &serial)) {
-		std::cout << "cannot do TIOCSSERIAL on " << name << " "  << strerror(errno) << std::endl;
+		std::cout << "cannot do TIOCGSERIAL on " << name << " "  << strerror(errno) << std::endl;
+	} else {
+		serial.flags |= ASYNC_LOW_LATENCY;  /* enable low latency  */
+		if (0 > ioctl(iFace, TIOCSSERIAL, &serial)) {
+			std::cout << "cannot do TIOCSSERIAL on " << name << " "  << strerror(errno) << std::endl;
+		}
 	}
 
 	struct termios2 options;
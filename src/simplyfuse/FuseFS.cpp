@@ -1,72 +1,230 @@
 #include "FuseFS.h"
 
 #define FUSE_USE_VERSION 31
-#include <fuse.h>
 #include <fuse/fuse_lowlevel.h>
 
 #include <stdexcept>
 #include <array>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <map>
 #include <mutex>
+#include <thread>
+#include <utility>
+#include <unordered_map>
 #include <cstring>
+#include <ctime>
 #include <iostream>
 #include <vector>
 #include <algorithm>
+#include <poll.h>
 
 #include <filesystem>
 
 namespace simplyfuse {
 namespace {
 
+// nodes are kept small, a filesystem may contain tens of thousands of them
+// children are sorted by name (binary search for lookups, stable order for readdir offsets)
 struct Node {
-	Node(std::string const& _name) : name(_name) {}
+	Node(std::string const& _name, fuse_ino_t _ino) : name(_name), ino(_ino) {}
 	Node* parent {nullptr};
 
-	std::map<std::string, std::unique_ptr<Node>> children;
+	std::vector<std::unique_ptr<Node>> children;
 	FuseFile* file {nullptr};
 	std::string name;
+	fuse_ino_t ino;
 
 	~Node() {}
-	auto getOrCreateChild(std::string const& name) -> std::pair<Node*, bool> {
-		auto& ptr = children[name];
-		bool needCreation = not ptr;
-		if (needCreation) {
-			ptr = std::make_unique<Node>(name);
-			ptr->parent = this;
+
+	auto lowerBound(std::string const& _name) -> std::vector<std::unique_ptr<Node>>::iterator {
+		return std::lower_bound(children.begin(), children.end(), _name, [](auto const& child, std::string const& n) { return child->name < n; });
+	}
+
+	Node* findChild(std::string const& _name) {
+		auto it = lowerBound(_name);
+		return (it != children.end() and (*it)->name == _name) ? it->get() : nullptr;
+	}
+
+	void eraseChild(std::string const& _name) {
+		auto it = lowerBound(_name);
+		if (it != children.end() and (*it)->name == _name) {
+			children.erase(it);
 		}
-		return std::make_pair(ptr.get(), needCreation);
 	}
 };
 
-void destroyNode(Node* node) {
-	Node* parent = node->parent;
-	parent->children.erase(node->name);
+static void lookup_callback(fuse_req_t req, fuse_ino_t parent, const char *name);
+static void forget_callback(fuse_req_t req, fuse_ino_t ino, unsigned long nlookup);
+static void getattr_callback(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info *fi);
+static void setattr_callback(fuse_req_t req, fuse_ino_t ino, struct stat *attr, int to_set, struct fuse_file_info *fi);
+static void readdir_callback(fuse_req_t req, fuse_ino_t ino, size_t size, off_t offset, struct fuse_file_info *fi);
+static void open_callback(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info *fi);
+static void release_callback(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info *fi);
+static void read_callback(fuse_req_t req, fuse_ino_t ino, size_t size, off_t offset, struct fuse_file_info *fi);
+static void write_callback(fuse_req_t req, fuse_ino_t ino, const char *buf, size_t size, off_t offset, struct fuse_file_info *fi);
+static void poll_callback(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info *fi, struct fuse_pollhandle *ph);
+
+// every request starts with this header (struct fuse_in_header of <linux/fuse.h>)
+struct InHeader {
+	uint32_t len;
+	uint32_t opcode;
+	uint64_t unique;
+	uint64_t nodeid;
+};
+
+// requests that call into the files' content handlers and might take long (e.g. bus transactions)
+bool isContentRequest(char const* buf, std::size_t size) {
+	enum : uint32_t { OpRead = 15, OpWrite = 16, OpPoll = 40 };
+	if (size < sizeof(InHeader)) {
+		return false;
+	}
+	InHeader header;
+	std::memcpy(&header, buf, sizeof(header));
+	return header.opcode == OpRead or header.opcode == OpWrite or header.opcode == OpPoll;
 }
 
-static int getattr_callback(const char *path, struct stat *stbuf);
-static int readdir_callback(const char *path, void *buf, fuse_fill_dir_t filler, off_t offset, struct fuse_file_info *fi);
-static int open_callback(const char *path, struct fuse_file_info *fi);
-static int read_callback(const char *path, char *buf, size_t size, off_t offset, struct fuse_file_info *fi);
-static int write_callback(const char *path, const char *buf, size_t size, off_t offset, struct fuse_file_info *fi);
-static int truncate_callback(const char *path, off_t offset);
+// files pinned by callbacks running on this thread (a callback may unregister its own file)
+thread_local std::vector<FuseFile*> pinnedByThisThread;
 
 }
 
 struct FuseFS::Pimpl {
 	struct fuse_chan* channel {nullptr};
-	struct fuse* fuse {nullptr};
+	struct fuse_session* session {nullptr};
 	std::filesystem::path mountPoint;
 	int fuseFD {0};
-
+	double cacheTimeout {1.};
 
 	std::recursive_mutex mutex;
-	std::map<Node*, FuseFile*> files;
 	std::multimap<FuseFile*, Node*> filesInvMap;
 
-	Node root{"/"};
+	// inode numbers are handed out once and never reused, the kernel may cache them for cacheTimeout seconds
+	fuse_ino_t nextIno {FUSE_ROOT_ID + 1};
+	std::unordered_map<fuse_ino_t, Node*> inodes;
+
+	Node root{"/", FUSE_ROOT_ID};
+	struct timespec mountTime;
 
 	bool tearDownMountPoint {false};
 
+	// callbacks pin the file they call into, unregistering a file waits until no callback uses it anymore
+	// so the owner may destroy a file as soon as it is unregistered
+	std::mutex pinMutex;
+	std::condition_variable pinCV;
+	std::map<FuseFile*, int> pins;
+
+	struct Pin {
+		Pin() = default;
+		Pin(Pimpl* _pimpl, FuseFile* _file) : pimpl(_pimpl), file(_file) {}
+		Pin(Pin&& other) : pimpl(other.pimpl), file(std::exchange(other.file, nullptr)) {}
+		Pin(Pin const&) = delete;
+		auto operator=(Pin const&) -> Pin& = delete;
+		auto operator=(Pin&& other) -> Pin& {
+			std::swap(pimpl, other.pimpl);
+			std::swap(file, other.file);
+			return *this;
+		}
+		~Pin() {
+			if (file) {
+				pimpl->unpin(file);
+			}
+		}
+		explicit operator bool() const { return file != nullptr; }
+		auto operator->() const -> FuseFile* { return file; }
+		auto get() const -> FuseFile* { return file; }
+
+		Pimpl* pimpl {nullptr};
+		FuseFile* file {nullptr};
+	};
+
+	std::vector<char> recvBuffer;
+
+	std::vector<std::thread> workers;
+	std::mutex queueMutex;
+	std::condition_variable queueCV;
+	std::deque<std::vector<char>> queue;
+	bool stopWorkers {false};
+	// set by stop(), content requests are answered with EINTR from then on, the files might be gone already
+	std::atomic<bool> stopped {false};
+
+	// every file has a change counter, every open file handle (fi->fh) remembers the count it has seen last
+	// poll() reports a file as readable if the counter moved on since
+	std::mutex pollMutex;
+	std::map<FuseFile*, uint64_t> changeCounts;
+	std::multimap<FuseFile*, struct fuse_pollhandle*> pollHandles;
+	uint64_t nextHandle {1};
+	std::unordered_map<uint64_t, uint64_t> seenChangeCounts;
+
+	// invalidations of kernel caches are sent from their own thread:
+	// the kernel locks the affected directory/pages while it processes them and might wait for a request we are about to answer
+	struct Invalidation {
+		fuse_ino_t  parent;
+		std::string name;  // if empty ino is invalidated instead of the entry name in parent
+		fuse_ino_t  ino;
+	};
+	std::thread notifier;
+	std::mutex notifyMutex;
+	std::condition_variable notifyCV;
+	std::deque<Invalidation> invalidations;
+	bool stopNotifier {false};
+
+	void work() {
+		while (true) {
+			std::vector<char> buf;
+			{
+				std::unique_lock lock{queueMutex};
+				queueCV.wait(lock, [&]{ return stopWorkers or not queue.empty(); });
+				if (stopWorkers) {
+					return;
+				}
+				buf = std::move(queue.front());
+				queue.pop_front();
+			}
+			fuse_session_process(session, buf.data(), buf.size(), channel);
+		}
+	}
+
+	void notify() {
+		while (true) {
+			Invalidation inval;
+			{
+				std::unique_lock lock{notifyMutex};
+				notifyCV.wait(lock, [&]{ return stopNotifier or not invalidations.empty(); });
+				if (stopNotifier) {
+					return;
+				}
+				inval = std::move(invalidations.front());
+				invalidations.pop_front();
+			}
+			// errors only mean that the kernel did not know about the entry
+			if (inval.name.empty()) {
+				fuse_lowlevel_notify_inval_inode(channel, inval.ino, 0, 0);
+			} else {
+				fuse_lowlevel_notify_inval_entry(channel, inval.parent, inval.name.data(), inval.name.size());
+			}
+		}
+	}
+
+	void invalidate(Invalidation inval) {
+		{
+			std::lock_guard lock{notifyMutex};
+			invalidations.emplace_back(std::move(inval));
+		}
+		notifyCV.notify_one();
+	}
+
+	// mutex must be held as long as the node is used
+	Node* getNode(fuse_ino_t ino) {
+		std::lock_guard lock{mutex};
+		if (ino == FUSE_ROOT_ID) {
+			return &root;
+		}
+		auto it = inodes.find(ino);
+		return it == inodes.end() ? nullptr : it->second;
+	}
+
 	Node* getNode(std::filesystem::path const& path) {
 		if (not path.is_absolute()) {
 			throw InvalidPathError("path must be absolute");
@@ -74,15 +232,34 @@ struct FuseFS::Pimpl {
 		std::lock_guard lock{mutex};
 		Node* node = &root;
 		for (auto it = std::next(path.begin()); it != path.end(); ++it) {
-			auto childit = node->children.find(*it);
-			if (childit == node->children.end()) {
+			node = node->findChild(*it);
+			if (not node) {
 				return nullptr;
 			}
-			node = childit->second.get();
 		}
 		return node;
 	}
 
+	auto getOrCreateChild(Node* node, std::string const& name) -> std::pair<Node*, bool> {
+		auto it = node->lowerBound(name);
+		if (it != node->children.end() and (*it)->name == name) {
+			return std::make_pair(it->get(), false);
+		}
+		auto& ptr = *node->children.insert(it, std::make_unique<Node>(name, nextIno++));
+		ptr->parent = node;
+		inodes[ptr->ino] = ptr.get();
+		// the kernel might have cached that this name does not exist
+		invalidate({node->ino, name, 0});
+		return std::make_pair(ptr.get(), true);
+	}
+
+	void destroyNode(Node* node) {
+		Node* parent = node->parent;
+		inodes.erase(node->ino);
+		invalidate({parent->ino, node->name, 0});
+		parent->eraseChild(node->name);
+	}
+
 	Node* getOrCreateNode(std::filesystem::path const& path) {
 		if (not path.is_absolute()) {
 			throw InvalidPathError("path must be absolute");
@@ -91,7 +268,7 @@ struct FuseFS::Pimpl {
 		Node* node = &root;
 		std::vector<Node*> createdNodes;
 		for (auto it = std::next(path.begin()); it != path.end(); ++it) {
-			auto goc = node->getOrCreateChild(*it);
+			auto goc = getOrCreateChild(node, *it);
 			node = goc.first;
 			if (goc.second) {
 				createdNodes.emplace_back(node);
@@ -107,25 +284,122 @@ struct FuseFS::Pimpl {
 		return node;
 	}
 
-	void deleteNode(Node* node) {
+	// returns the file of node if it is not registered anywhere else (the caller has to waitUntilUnpinned before it is gone)
+	FuseFile* deleteNode(Node* node) {
 		if (not node->children.empty()) {
 			throw std::logic_error("cannot destroy a node which has children");
 		}
+		FuseFile* released {nullptr};
 		if (node->file) {
 			auto range = filesInvMap.equal_range(node->file);
 			if (std::distance(range.first, range.second) == 1) {
 				node->file->fuseFS = nullptr;
+				dropPollHandles(node->file);
+				released = node->file;
 			}
 			filesInvMap.erase(std::find_if(range.first, range.second, [&](auto const& p) { return p.second == node; }));
-			files.erase(node);
 		}
 		destroyNode(node);
+		return released;
+	}
+
+	Pin pin(fuse_ino_t ino) {
+		if (stopped) {
+			return {};
+		}
+		std::lock_guard lock{mutex};
+		Node* node = getNode(ino);
+		if (not node or not node->file) {
+			return {};
+		}
+		return pinLocked(node->file);
+	}
+
+	// mutex must be held (so file cannot be unregistered in between)
+	Pin pinLocked(FuseFile* file) {
+		std::lock_guard lock{pinMutex};
+		++pins[file];
+		pinnedByThisThread.push_back(file);
+		return Pin{this, file};
+	}
+
+	void unpin(FuseFile* file) {
+		{
+			std::lock_guard lock{pinMutex};
+			if (--pins[file] == 0) {
+				pins.erase(file);
+			}
+			pinnedByThisThread.erase(std::find(pinnedByThisThread.begin(), pinnedByThisThread.end(), file));
+		}
+		pinCV.notify_all();
+	}
+
+	// must not be called with mutex held, pinned callbacks might need it to finish
+	void waitUntilUnpinned(std::vector<FuseFile*> const& files) {
+		std::unique_lock lock{pinMutex};
+		pinCV.wait(lock, [&]{
+			return std::all_of(files.begin(), files.end(), [&](FuseFile* file) {
+				auto it = pins.find(file);
+				return it == pins.end() or it->second == std::count(pinnedByThisThread.begin(), pinnedByThisThread.end(), file);
+			});
+		});
+	}
+
+	// pollMutex must be held
+	uint64_t getChangeCount(FuseFile* file) {
+		auto it = changeCounts.find(file);
+		return it == changeCounts.end() ? 0 : it->second;
+	}
+
+	uint64_t openHandle(FuseFile* file) {
+		std::lock_guard lock{pollMutex};
+		uint64_t handle = nextHandle++;
+		seenChangeCounts[handle] = getChangeCount(file);
+		return handle;
+	}
+
+	void markSeen(uint64_t handle, FuseFile* file) {
+		std::lock_guard lock{pollMutex};
+		seenChangeCounts[handle] = getChangeCount(file);
+	}
+
+	void closeHandle(uint64_t handle) {
+		std::lock_guard lock{pollMutex};
+		seenChangeCounts.erase(handle);
+	}
+
+	void dropPollHandles(FuseFile* file) {
+		std::lock_guard lock{pollMutex};
+		auto range = pollHandles.equal_range(file);
+		for (auto it = range.first; it != range.second; ++it) {
+			fuse_pollhandle_destroy(it->second);
+		}
+		pollHandles.erase(range.first, range.second);
+		changeCounts.erase(file);
+	}
+
+	auto getStat(Node const* node) -> struct stat {
+		struct stat stbuf;
+		memset(&stbuf, 0, sizeof(stbuf));
+		stbuf.st_ino  = node->ino;
+		stbuf.st_mtim = mountTime;
+		if (node->file) {
+			stbuf.st_mode  = S_IFREG | node->file->getFilePermissions();
+			stbuf.st_nlink = 1;
+			stbuf.st_size  = node->file->getSize();
+		} else {
+			stbuf.st_mode  = S_IFDIR | 0755;
+			stbuf.st_nlink = 2;
+		}
+		return stbuf;
 	}
 };
 
-FuseFS::FuseFS(std::filesystem::path const& mountPoint) :
+FuseFS::FuseFS(std::filesystem::path const& mountPoint, int numWorkers, double cacheTimeout) :
 		pimpl { std::make_unique<Pimpl>() } {
-	pimpl->mountPoint = mountPoint;
+	pimpl->mountPoint   = mountPoint;
+	pimpl->cacheTimeout = cacheTimeout;
+	clock_gettime(CLOCK_REALTIME, &pimpl->mountTime);
 
 	if (not std::filesystem::is_directory(mountPoint)) {
 		// try to create the mountpoint
@@ -142,35 +416,91 @@ FuseFS::FuseFS(std::filesystem::path const& mountPoint) :
 	if (not pimpl->channel) {
 		throw MountError("cannot mount");
 	}
-	struct fuse_operations fuse_operations = { };
-	fuse_operations.getattr = getattr_callback;
-	fuse_operations.open = open_callback;
-	fuse_operations.read = read_callback;
-	fuse_operations.write = write_callback;
-	fuse_operations.readdir = readdir_callback;
-	fuse_operations.truncate = truncate_callback;
-	pimpl->fuse = fuse_new(pimpl->channel, nullptr, &fuse_operations,
-			sizeof(fuse_operations), this);
+	struct fuse_lowlevel_ops fuse_operations = { };
+	fuse_operations.lookup   = lookup_callback;
+	fuse_operations.forget   = forget_callback;
+	fuse_operations.getattr  = getattr_callback;
+	fuse_operations.setattr  = setattr_callback;
+	fuse_operations.open     = open_callback;
+	fuse_operations.release  = release_callback;
+	fuse_operations.read     = read_callback;
+	fuse_operations.write    = write_callback;
+	fuse_operations.readdir  = readdir_callback;
+	fuse_operations.poll     = poll_callback;
+	pimpl->session = fuse_lowlevel_new(nullptr, &fuse_operations, sizeof(fuse_operations), this);
+	if (not pimpl->session) {
+		fuse_unmount(pimpl->mountPoint.c_str(), pimpl->channel);
+		throw MountError("cannot create fuse session");
+	}
+	fuse_session_add_chan(pimpl->session, pimpl->channel);
 	pimpl->fuseFD = fuse_chan_fd(pimpl->channel);
+	pimpl->recvBuffer.resize(fuse_chan_bufsize(pimpl->channel));
+
+	pimpl->notifier = std::thread([this]{ pimpl->notify(); });
+	for (int i{0}; i < numWorkers; ++i) {
+		pimpl->workers.emplace_back([this]{ pimpl->work(); });
+	}
 }
 
 FuseFS::~FuseFS() {
+	stop();
+	{
+		std::lock_guard lock{pimpl->notifyMutex};
+		pimpl->stopNotifier = true;
+	}
+	pimpl->notifyCV.notify_all();
+	pimpl->notifier.join();
+
+	for (auto const& [file, ph] : pimpl->pollHandles) {
+		fuse_pollhandle_destroy(ph);
+	}
+
+	fuse_session_remove_chan(pimpl->channel);
+	fuse_session_destroy(pimpl->session);
 	fuse_unmount(pimpl->mountPoint.c_str(), pimpl->channel);
-	fuse_destroy(pimpl->fuse);
 
 	if (pimpl->tearDownMountPoint) {
 		std::filesystem::remove(pimpl->mountPoint);
 	}
 }
+void FuseFS::stop() {
+	{
+		std::lock_guard lock{pimpl->queueMutex};
+		pimpl->stopWorkers = true;
+	}
+	pimpl->queueCV.notify_all();
+	for (auto& worker : pimpl->workers) {
+		worker.join();
+	}
+	pimpl->workers.clear();
+	// every request needs an answer, but the files must not be called anymore
+	pimpl->stopped = true;
+	for (auto const& buf : pimpl->queue) {
+		fuse_session_process(pimpl->session, buf.data(), buf.size(), pimpl->channel);
+	}
+	pimpl->queue.clear();
+}
+
 int FuseFS::getFD() const {
 	return pimpl->fuseFD;
 }
 
 void FuseFS::loop() {
-	struct fuse_cmd *cmd = fuse_read_cmd(pimpl->fuse);
-	if (cmd) {
-		fuse_process_cmd(pimpl->fuse, cmd);
+	struct fuse_chan* channel = pimpl->channel;
+	int res = fuse_chan_recv(&channel, pimpl->recvBuffer.data(), pimpl->recvBuffer.size());
+	if (res <= 0) {
+		return;
 	}
+	// metadata requests are answered right away, they must not wait behind reads and writes that are stuck on the bus
+	if (pimpl->workers.empty() or not isContentRequest(pimpl->recvBuffer.data(), res)) {
+		fuse_session_process(pimpl->session, pimpl->recvBuffer.data(), res, channel);
+		return;
+	}
+	{
+		std::lock_guard lock{pimpl->queueMutex};
+		pimpl->queue.emplace_back(pimpl->recvBuffer.begin(), std::next(pimpl->recvBuffer.begin(), res));
+	}
+	pimpl->queueCV.notify_one();
 }
 
 void FuseFS::registerFile(std::filesystem::path const& _path, FuseFile& file) {
@@ -185,7 +515,6 @@ void FuseFS::registerFile(std::filesystem::path const& _path, FuseFile& file) {
 	if (not node->children.empty()) {
 		throw InvalidPathError("file already exists");
 	}
-	pimpl->files[node] = &file;
 	pimpl->filesInvMap.emplace(&file, node);
 }
 
@@ -193,14 +522,36 @@ void FuseFS::unregisterFile(FuseFile& file) {
 	if (file.fuseFS != this) {
 		throw std::invalid_argument("the passed file is not registered with this fuse instance");
 	}
-	std::lock_guard lock{pimpl->mutex};
-	file.fuseFS = nullptr;
-	auto range = pimpl->filesInvMap.equal_range(&file);
-	std::for_each(range.first, range.second, [=] (auto const& p) {
-		pimpl->files.erase(p.second);
-		destroyNode(p.second);
-	});
-	pimpl->filesInvMap.erase(range.first, range.second);
+	{
+		std::lock_guard lock{pimpl->mutex};
+		file.fuseFS = nullptr;
+		auto range = pimpl->filesInvMap.equal_range(&file);
+		std::for_each(range.first, range.second, [=] (auto const& p) {
+			pimpl->destroyNode(p.second);
+		});
+		pimpl->filesInvMap.erase(range.first, range.second);
+		pimpl->dropPollHandles(&file);
+	}
+	pimpl->waitUntilUnpinned({&file});
+}
+
+void FuseFS::notifyChanged(FuseFile& file) {
+	if (not file.useDirectIO()) {
+		// reads of this file may be served from the page cache
+		std::lock_guard lock{pimpl->mutex};
+		auto range = pimpl->filesInvMap.equal_range(&file);
+		for (auto it = range.first; it != range.second; ++it) {
+			pimpl->invalidate({0, {}, it->second->ino});
+		}
+	}
+	std::lock_guard lock{pimpl->pollMutex};
+	++pimpl->changeCounts[&file];
+	auto range = pimpl->pollHandles.equal_range(&file);
+	for (auto it = range.first; it != range.second; ++it) {
+		fuse_lowlevel_notify_poll(it->second);
+		fuse_pollhandle_destroy(it->second);
+	}
+	pimpl->pollHandles.erase(range.first, range.second);
 }
 
 void FuseFS::unregisterFile(std::filesystem::path const& path, FuseFile& file) {
@@ -208,9 +559,15 @@ void FuseFS::unregisterFile(std::filesystem::path const& path, FuseFile& file) {
 		throw std::invalid_argument("the passed file is not registered with this fuse instance");
 	}
 
-	std::lock_guard lock{pimpl->mutex};
-	Node* node = pimpl->getNode(path);
-	pimpl->deleteNode(node);
+	FuseFile* released {nullptr};
+	{
+		std::lock_guard lock{pimpl->mutex};
+		Node* node = pimpl->getNode(path);
+		released = pimpl->deleteNode(node);
+	}
+	if (released) {
+		pimpl->waitUntilUnpinned({released});
+	}
 }
 
 void FuseFS::mkdir(std::filesystem::path const& _path) {
@@ -221,102 +578,232 @@ void FuseFS::mkdir(std::filesystem::path const& _path) {
 
 namespace {
 
-void rmDirHelper(Node* node, FuseFS::Pimpl* pimpl) {
+void rmDirHelper(Node* node, FuseFS::Pimpl* pimpl, std::vector<FuseFile*>& released) {
 	if (not node) {
 		return;
 	}
 	std::vector<Node*> children;
-	std::transform(node->children.begin(), node->children.end(), std::back_inserter(children), [](auto const& p) { return p.second.get(); });
+	std::transform(node->children.begin(), node->children.end(), std::back_inserter(children), [](auto const& p) { return p.get(); });
 	for (auto & child : children) {
-		rmDirHelper(child, pimpl);
+		rmDirHelper(child, pimpl, released);
+	}
+	if (auto file = pimpl->deleteNode(node)) {
+		released.push_back(file);
 	}
-	pimpl->deleteNode(node);
 }
 
 }
 
 void FuseFS::rmdir(std::filesystem::path const& path) {
-	Node* node = pimpl->getNode(path);
-	if (node) {
-		rmDirHelper(node, pimpl.get());
+	std::vector<FuseFile*> released;
+	{
+		std::lock_guard lock{pimpl->mutex};
+		Node* node = pimpl->getNode(path);
+		if (node) {
+			rmDirHelper(node, pimpl.get(), released);
+		}
 	}
+	pimpl->waitUntilUnpinned(released);
 }
 
 namespace {
 
-Node* getNode(std::string const& path) {
-	struct fuse_context* context = fuse_get_context();
-	FuseFS* fusefs = reinterpret_cast<FuseFS*>(context->private_data);
-	return fusefs->pimpl->getNode(path);
+FuseFS::Pimpl* getPimpl(fuse_req_t req) {
+	FuseFS* fusefs = reinterpret_cast<FuseFS*>(fuse_req_userdata(req));
+	return fusefs->pimpl.get();
 }
 
-int getattr_callback(const char *path, struct stat *stbuf) {
-	memset(stbuf, 0, sizeof(*stbuf));
 
-	Node* node = getNode(path);
-	if (not node) {
-		return -ENOENT;
-	}
-	clock_gettime(CLOCK_REALTIME, &stbuf->st_mtim);
-	if (node->file) {
-		stbuf->st_mode = S_IFREG | node->file->getFilePermissions();
-		stbuf->st_nlink = 1;
-		stbuf->st_size = node->file->getSize();
-		return 0;
-	} else {
-		stbuf->st_mode = S_IFDIR | 0755;
-		stbuf->st_nlink = 2;
-		return 0;
-	}
-	return -ENOENT;
+void lookup_callback(fuse_req_t req, fuse_ino_t parent, const char *name) {
+	auto pimpl = getPimpl(req);
+	struct fuse_entry_param entry;
+	memset(&entry, 0, sizeof(entry));
+	entry.attr_timeout  = pimpl->cacheTimeout;
+	entry.entry_timeout = pimpl->cacheTimeout;
+	{
+		std::lock_guard lock{pimpl->mutex};
+		Node* node = pimpl->getNode(parent);
+		if (not node) {
+			fuse_reply_err(req, ENOENT);
+			return;
+		}
+		Node* child = node->findChild(name);
+		if (not child) {
+			// ino 0 makes the kernel remember that the entry does not exist (until it is created)
+			fuse_reply_entry(req, &entry);
+			return;
+		}
+		entry.ino  = child->ino;
+		entry.attr = pimpl->getStat(child);
+	}
+	fuse_reply_entry(req, &entry);
 }
 
-int readdir_callback(const char *path, void *buf, fuse_fill_dir_t filler, off_t, struct fuse_file_info *) {
-	Node* node = getNode(path);
-	if (not node) {
-		return -ENOENT;
-	}
-	for (auto& child : node->children) {
-		filler(buf, child.first.c_str(), NULL, 0);
+void forget_callback(fuse_req_t req, fuse_ino_t, unsigned long) {
+	// inodes live as long as their node, there is nothing to free
+	fuse_reply_none(req);
+}
+
+void replyAttr(fuse_req_t req, FuseFS::Pimpl* pimpl, fuse_ino_t ino) {
+	struct stat stbuf;
+	{
+		std::lock_guard lock{pimpl->mutex};
+		Node* node = pimpl->getNode(ino);
+		if (not node) {
+			fuse_reply_err(req, ENOENT);
+			return;
+		}
+		stbuf = pimpl->getStat(node);
 	}
+	fuse_reply_attr(req, &stbuf, pimpl->cacheTimeout);
+}
 
-	filler(buf, ".", NULL, 0);
-	filler(buf, "..", NULL, 0);
-	return 0;
+void getattr_callback(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info *) {
+	replyAttr(req, getPimpl(req), ino);
 }
 
-int open_callback(const char *path, struct fuse_file_info *) {
-	Node* node = getNode(path);
-	if (not node or not node->file) {
-		return -ENOENT;
+void setattr_callback(fuse_req_t req, fuse_ino_t ino, struct stat *attr, int to_set, struct fuse_file_info *) {
+	auto pimpl = getPimpl(req);
+	if (to_set & FUSE_SET_ATTR_SIZE) {
+		if (auto file = pimpl->pin(ino)) {
+			int res = file->onTruncate(attr->st_size);
+			if (res < 0) {
+				fuse_reply_err(req, -res);
+				return;
+			}
+		}
 	}
-	return node->file->onOpen();
+	replyAttr(req, pimpl, ino);
 }
 
-int read_callback(const char *path, char *buf, size_t size, off_t offset, struct fuse_file_info *) {
-	Node* node = getNode(path);
-	if (not node or not node->file) {
-		return -ENOENT;
+void readdir_callback(fuse_req_t req, fuse_ino_t ino, size_t size, off_t offset, struct fuse_file_info *) {
+	auto pimpl = getPimpl(req);
+	std::vector<char> buf;
+	auto addEntry = [&](std::string const& name, Node const* node) {
+		struct stat stbuf;
+		memset(&stbuf, 0, sizeof(stbuf));
+		stbuf.st_ino  = node->ino;
+		stbuf.st_mode = node->file ? S_IFREG : S_IFDIR;
+		std::size_t oldSize = buf.size();
+		buf.resize(oldSize + fuse_add_direntry(req, nullptr, 0, name.c_str(), nullptr, 0));
+		fuse_add_direntry(req, buf.data() + oldSize, buf.size() - oldSize, name.c_str(), &stbuf, buf.size());
+	};
+	{
+		std::lock_guard lock{pimpl->mutex};
+		Node* node = pimpl->getNode(ino);
+		if (not node or node->file) {
+			fuse_reply_err(req, node ? ENOTDIR : ENOENT);
+			return;
+		}
+		addEntry(".", node);
+		addEntry("..", node->parent ? node->parent : node);
+		for (auto& child : node->children) {
+			addEntry(child->name, child.get());
+		}
+	}
+	if (offset < 0 or std::size_t(offset) >= buf.size()) {
+		fuse_reply_buf(req, nullptr, 0);
+		return;
+	}
+	fuse_reply_buf(req, buf.data() + offset, std::min(buf.size() - offset, size));
+}
+
+void open_callback(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info *fi) {
+	auto pimpl = getPimpl(req);
+	FuseFS::Pimpl::Pin file;
+	{
+		std::lock_guard lock{pimpl->mutex};
+		Node* node = pimpl->getNode(ino);
+		if (not node) {
+			fuse_reply_err(req, ENOENT);
+			return;
+		}
+		if (not node->file) {
+			fuse_reply_err(req, EISDIR);
+			return;
+		}
+		file = pimpl->pinLocked(node->file);
+	}
+	fi->direct_io = file->useDirectIO();
+	int res = file->onOpen();
+	if (res < 0) {
+		fuse_reply_err(req, -res);
+		return;
 	}
-	return node->file->onRead(buf, size, offset);
+	fi->fh = pimpl->openHandle(file.get());
+	fuse_reply_open(req, fi);
+}
+
+void release_callback(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info *fi) {
+	auto pimpl = getPimpl(req);
+	pimpl->closeHandle(fi->fh);
+	auto file = pimpl->pin(ino);
+	int res = file ? file->onClose() : 0;
+	fuse_reply_err(req, res < 0 ? -res : 0);
 }
 
-int write_callback(const char *path, const char *buf, size_t size, off_t offset, struct fuse_file_info *) {
-	Node* node = getNode(path);
-	if (not node or not node->file) {
-		return -ENOENT;
+void read_callback(fuse_req_t req, fuse_ino_t ino, size_t size, off_t offset, struct fuse_file_info *fi) {
+	auto file = getPimpl(req)->pin(ino);
+	if (not file) {
+		fuse_reply_err(req, getPimpl(req)->stopped ? EINTR : ENOENT);
+		return;
 	}
-	return node->file->onWrite(buf, size, offset);
+	getPimpl(req)->markSeen(fi->fh, file.get());
+	std::vector<char> buf(size);
+	int res = file->onRead(buf.data(), size, offset);
+	if (res < 0) {
+		fuse_reply_err(req, -res);
+		return;
+	}
+	fuse_reply_buf(req, buf.data(), std::min(std::size_t(res), size));
 }
 
-int truncate_callback(const char *path, off_t offset) {
-	Node* node = getNode(path);
-	if (not node or not node->file) {
-		return -ENOENT;
+void write_callback(fuse_req_t req, fuse_ino_t ino, const char *buf, size_t size, off_t offset, struct fuse_file_info *) {
+	auto file = getPimpl(req)->pin(ino);
+	if (not file) {
+		fuse_reply_err(req, getPimpl(req)->stopped ? EINTR : ENOENT);
+		return;
+	}
+	int res = file->onWrite(buf, size, offset);
+	if (res < 0) {
+		fuse_reply_err(req, -res);
+		return;
 	}
-	return node->file->onTruncate(offset);
+	fuse_reply_write(req, res);
 }
 
+void poll_callback(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info *fi, struct fuse_pollhandle *ph) {
+	auto pimpl = getPimpl(req);
+	auto file = pimpl->pin(ino);
+	if (not file) {
+		if (ph) {
+			fuse_pollhandle_destroy(ph);
+		}
+		fuse_reply_err(req, pimpl->stopped ? EINTR : ENOENT);
+		return;
+	}
+	unsigned revents = 0;
+	if (file->getFilePermissions() & 0222) {
+		revents |= POLLOUT | POLLWRNORM;
+	}
+	{
+		// the file might have been unregistered meanwhile, its poll handles are dropped already then
+		std::lock_guard lock{pimpl->mutex};
+		std::lock_guard pollLock{pimpl->pollMutex};
+		bool registered = pimpl->filesInvMap.count(file.get()) > 0;
+		if (pimpl->getChangeCount(file.get()) != pimpl->seenChangeCounts[fi->fh]) {
+			revents |= POLLIN | POLLRDNORM | POLLPRI;
+			if (ph) {
+				fuse_pollhandle_destroy(ph);
+			}
+		} else if (ph and not registered) {
+			fuse_pollhandle_destroy(ph);
+		} else if (ph) {
+			pimpl->pollHandles.emplace(file.get(), ph);
+		}
+	}
+	fuse_reply_poll(req, revents);
+}
 
 }
 
@@ -22,11 +22,19 @@ struct MountError : std::logic_error {
 
 struct FuseFS {
 	friend class FuseFile;
-	FuseFS(std::filesystem::path const& mountPoint);
+	// numWorkers > 0 spawns a pool of threads that process reads, writes and polls concurrently
+	// (a slow read of one file does not block requests to other files), metadata requests are always answered by loop() itself
+	// the kernel caches names and attributes (but not the content of direct io files) for cacheTimeout seconds
+	FuseFS(std::filesystem::path const& mountPoint, int numWorkers=0, double cacheTimeout=1.);
 	virtual ~FuseFS();
 
+	// read one request and process it (or hand it over to the worker pool)
 	void loop();
 
+	// join the workers and answer all requests still queued with EINTR, files are not called anymore afterwards
+	// must be called before the registered files are destroyed (the destructor calls it, too)
+	void stop();
+
 	int getFD() const;
 
 	// register a file in the file system (a file can be registered multiple times)
@@ -38,6 +46,9 @@ struct FuseFS {
 	// unregister all instances of this file from the file system
 	void unregisterFile(FuseFile& file);
 
+	// tell processes waiting in poll()/select() on this file that its content changed
+	void notifyChanged(FuseFile& file);
+
 	// create a directory (will create intermediate directories, too)
 	void mkdir(std::filesystem::path const& path);
 
@@ -16,6 +16,7 @@ int FuseFile::onRead(char*, std::size_t, off_t)  { return -ENOENT; }
 int FuseFile::onWrite(const char*, std::size_t, off_t) { return -ENOENT; }
 std::size_t FuseFile::getSize() { return 4096; }
 int FuseFile::onTruncate(off_t) { return -ENOENT; }
+bool FuseFile::useDirectIO() { return false; }
 
 int FuseFile::getFilePermissions() {
 	return 0666;
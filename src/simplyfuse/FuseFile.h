@@ -24,6 +24,9 @@ struct FuseFile {
 	virtual std::size_t getSize();
 	virtual int onTruncate(off_t offset);
 
+	// files with content that changes on its own (e.g., reflects some hardware) should bypass the page cache
+	virtual bool useDirectIO();
+
 	virtual int getFilePermissions();
 
 	friend class FuseFS;
@@ -0,0 +1,98 @@
+#include "usb2dynamixel/Simulator.h"
+#include "usb2dynamixel/MotorMetaInfo.h"
+#include "globalOptions.h"
+
+#include <atomic>
+#include <csignal>
+#include <filesystem>
+#include <iostream>
+
+namespace {
+
+void runSimulate();
+auto simulateCmd = sargp::Command{"simulate", "emulate motors behind a pseudo terminal that other inspexel calls can use as --device", runSimulate};
+auto optMotors   = simulateCmd.Parameter<std::vector<std::string>>({"1:MX28"}, "motors", "motors to simulate as <id>[-<last id>]:<model name or number>[:<return delay in us>]");
+auto optLink     = simulateCmd.Parameter<std::string>("", "link", "create a symlink with this name pointing to the pseudo terminal");
+auto optLoss     = simulateCmd.Parameter<double>(0., "loss", "probability that a motor misses an instruction packet");
+auto optNoise    = simulateCmd.Parameter<double>(0., "noise", "probability that a byte of a status packet gets corrupted");
+auto optSeed     = simulateCmd.Parameter<int>(0, "seed", "seed of the random numbers for --loss and --noise");
+auto optUnpaced  = simulateCmd.Flag("unpaced", "answer as fast as possible instead of as slow as a bus running at --baudrate");
+
+using namespace dynamixel;
+
+std::atomic<bool> terminateFlag {false};
+
+auto parseMotors(std::vector<std::string> const& specs) -> std::vector<SimulatedMotor> {
+	std::vector<SimulatedMotor> motors;
+	for (auto const& spec : specs) {
+		auto colon = spec.find(':');
+		if (colon == std::string::npos) {
+			throw std::runtime_error("motor \"" + spec + "\" must be given as <id>:<model>");
+		}
+		auto ids   = spec.substr(0, colon);
+		auto model = spec.substr(colon + 1);
+		std::optional<std::chrono::microseconds> returnDelay;
+		if (auto delay = model.find(':'); delay != std::string::npos) {
+			returnDelay = std::chrono::microseconds{std::stoi(model.substr(delay + 1))};
+			model       = model.substr(0, delay);
+		}
+
+		auto info = meta::getMotorInfo(model);
+		if (not info and not model.empty() and std::all_of(model.begin(), model.end(), ::isdigit)) {
+			info = meta::getMotorInfo(uint16_t(std::stoi(model)));
+		}
+		if (not info) {
+			throw std::runtime_error("unknown model \"" + model + "\"");
+		}
+
+		auto dash  = ids.find('-');
+		auto first = std::stoi(ids.substr(0, dash));
+		auto last  = dash == std::string::npos ? first : std::stoi(ids.substr(dash + 1));
+		if (first < 0 or last >= BroadcastID or first > last) {
+			throw std::runtime_error("invalid motor ids \"" + ids + "\"");
+		}
+		for (int id{first}; id <= last; ++id) {
+			motors.push_back({MotorID(id), info->modelNumber, returnDelay});
+		}
+	}
+	return motors;
+}
+
+void runSimulate() {
+	auto options = Simulator::Options{};
+	options.protocol = *g_protocolVersion;
+	options.baudrate = optUnpaced ? 0 : *g_baudrate;
+	options.loss     = *optLoss;
+	options.noise    = *optNoise;
+	options.seed     = uint32_t(*optSeed);
+	auto motors    = parseMotors(*optMotors);
+	auto simulator = Simulator{motors, options};
+
+	auto device = simulator.getDevice();
+	if (not optLink->empty()) {
+		std::filesystem::remove(*optLink);
+		std::filesystem::create_symlink(simulator.getDevice(), *optLink);
+		device = *optLink;
+	}
+
+	auto sigHandler = [](int){ terminateFlag = true; };
+	std::signal(SIGINT, sigHandler);
+	std::signal(SIGTERM, sigHandler);
+
+	std::cout << "simulating " << motors.size() << " motors with protocol " << int(options.protocol) << " on " << simulator.getDevice();
+	if (options.baudrate > 0) {
+		std::cout << " at " << options.baudrate << " baud";
+	}
+	std::cout << "\n";
+	std::cout << "use: inspexel --device " << device << " --protocol_version " << int(options.protocol) << std::endl;
+	simulator.run(terminateFlag);
+
+	if (not optLink->empty()) {
+		std::filesystem::remove(*optLink);
+	}
+	auto stats = simulator.getStats();
+	std::cout << stats.instructions << " instructions, " << stats.statusPackets << " status packets, "
+	          << stats.corrupted << " corrupted packets, " << stats.lost << " lost, " << stats.noisyBytes << " corrupted bytes sent\n";
+}
+
+}
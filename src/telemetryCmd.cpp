@@ -0,0 +1,62 @@
+#include "usb2dynamixel/USB2Dynamixel.h"
+#include "usb2dynamixel/MotorMetaInfo.h"
+#include "usb2dynamixel/TelemetryPoller.h"
+#include "usb2dynamixel/TelemetryRing.h"
+#include "globalOptions.h"
+
+#include "commonTasks.h"
+
+#include <atomic>
+#include <csignal>
+#include <iostream>
+
+namespace {
+
+void runTelemetry();
+auto telemetryCmd = sargp::Command{"telemetry", "continuously read registers of all motors and publish them in a shared memory ring", runTelemetry};
+auto optIDs       = telemetryCmd.Parameter<std::set<int>>({}, "ids", "motors to read (default: all detected motors)");
+auto optRegisters = telemetryCmd.Parameter<std::vector<int>>({}, "registers", "registers to read (default: present position)");
+auto optRate      = telemetryCmd.Parameter<int>(100, "rate_hz", "frames per second");
+auto optShmName   = telemetryCmd.Parameter<std::string>("/inspexel-telemetry", "shm_name", "name of the shared memory object (see shm_open)");
+auto optSlots     = telemetryCmd.Parameter<int>(64, "slots", "number of frames the ring holds");
+
+using namespace dynamixel;
+
+std::atomic<bool> terminateFlag {false};
+
+void runTelemetry() {
+	auto timeout = std::chrono::microseconds{*g_timeout};
+	auto usb2dyn = USB2Dynamixel(*g_baudrate, *g_device, *g_protocolVersion);
+
+	// a single bulk read can only address one register window, so all motors must share a layout
+	auto [layoutType, motors] = detectMotorsOfOneLayout(*optIDs, usb2dyn, timeout);
+	auto registers = *optRegisters;
+	if (registers.empty()) {
+		registers.push_back(findRegister(layoutType, "Present Position"));
+	}
+
+	auto frame = TelemetryFrame{describeRegisters(layoutType, registers)};
+	std::vector<telemetry::ColumnInfo> columnInfos;
+	for (auto const& column : frame.columns) {
+		auto const& d = column.description;
+		columnInfos.push_back({d.baseRegister, d.width, d.isSigned, {}});
+	}
+	auto ring = telemetry::RingWriter{*optShmName, columnInfos, motors.size(), std::size_t(std::max(1, *optSlots))};
+	std::cout << "publishing " << motors.size() << " motors on " << *optShmName << "\n";
+
+	auto sigHandler = [](int){ terminateFlag = true; };
+	std::signal(SIGINT, sigHandler);
+	std::signal(SIGTERM, sigHandler);
+
+	std::vector<int32_t const*> columnPtrs(frame.columns.size());
+	auto period = std::chrono::nanoseconds{std::chrono::seconds{1}} / std::max(1, *optRate);
+	auto poller = TelemetryPoller{usb2dyn, motors, frame, period, timeout};
+	poller.run([&](std::chrono::nanoseconds timestamp, TelemetryFrame const& polled) {
+		for (std::size_t c{0}; c < polled.columns.size(); ++c) {
+			columnPtrs[c] = polled.columns[c].values.data();
+		}
+		ring.publish(polled.motors.data(), polled.motors.size(), columnPtrs.data(), timestamp.count());
+	}, terminateFlag);
+}
+
+}
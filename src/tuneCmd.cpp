@@ -0,0 +1,198 @@
+#include "usb2dynamixel/USB2Dynamixel.h"
+#include "usb2dynamixel/AdapterProfile.h"
+#include "usb2dynamixel/LatencyHistogram.h"
+#include "usb2dynamixel/MotorMetaInfo.h"
+#include "globalOptions.h"
+
+#include "commonTasks.h"
+
+#include <iomanip>
+#include <iostream>
+#include <memory>
+
+namespace {
+
+void runTune();
+auto tuneCmd         = sargp::Command{"tune", "measure the round trip time of the adapter, apply the fastest adapter settings and save them as profile", runTune};
+auto optIDs          = tuneCmd.Parameter<std::set<int>>({}, "ids", "motors to search for the one to measure with (default: all)");
+auto optPayloads     = tuneCmd.Parameter<std::vector<int>>({1, 8, 32, 64}, "payloads", "numbers of bytes read per transaction");
+auto optTransactions = tuneCmd.Parameter<int>(100, "transactions", "transactions per setting and payload");
+auto optTimers       = tuneCmd.Parameter<std::vector<int>>({16, 8, 4, 2, 1}, "latency_timers", "latency_timer values (ms) to try on FTDI adapters");
+auto optNoSave       = tuneCmd.Flag("no_save", "apply the best settings but do not save them as profile");
+
+using namespace dynamixel;
+
+struct Measurement {
+	std::size_t              payload;
+	uint64_t                 timeouts;
+	std::chrono::nanoseconds p50, p90, p99, max;
+};
+
+struct Candidate {
+	adapter::Settings        settings;
+	std::vector<Measurement> measurements;
+
+	// the tail latency matters for control loops
+	[[nodiscard]] auto score() const -> std::chrono::nanoseconds {
+		std::chrono::nanoseconds sum {0};
+		for (auto const& m : measurements) {
+			sum += m.p90 + m.timeouts * std::chrono::microseconds{*g_timeout};
+		}
+		return sum;
+	}
+};
+
+auto measure(USB2Dynamixel const& usb2dyn, MotorID motor, std::vector<std::size_t> const& payloads, std::chrono::microseconds timeout) -> std::vector<Measurement> {
+	std::vector<Measurement> measurements;
+	auto histogram = std::make_unique<LatencyHistogram>();
+	for (auto payload : payloads) {
+		histogram->reset();
+		uint64_t timeouts {0};
+		for (int i{0}; i < std::max(1, *optTransactions); ++i) {
+			auto start = std::chrono::steady_clock::now();
+			auto [timeoutFlag, motorID, errorCode, rxBuf] = usb2dyn.read(motor, 0, payload, timeout);
+			if (timeoutFlag or motorID != motor) {
+				++timeouts;
+				continue;
+			}
+			histogram->record(std::chrono::steady_clock::now() - start);
+		}
+		measurements.push_back({payload, timeouts, histogram->percentile(.5), histogram->percentile(.9), histogram->percentile(.99), histogram->max()});
+	}
+	return measurements;
+}
+
+// the settings of a freshly plugged in adapter (only those it supports)
+// "before" is measured with them, the port was opened with the saved profile already applied
+auto driverDefaults(adapter::Settings const& supported) -> adapter::Settings {
+	adapter::Settings defaults;
+	if (supported.latencyTimer) {
+		defaults.latencyTimer = 16;
+	}
+	if (supported.lowLatency) {
+		defaults.lowLatency = false;
+	}
+	return defaults;
+}
+
+auto describe(adapter::Settings const& settings) -> std::string {
+	std::string str;
+	str += settings.latencyTimer ? "timer " + std::to_string(*settings.latencyTimer) + "ms" : "no timer";
+	str += settings.lowLatency ? (*settings.lowLatency ? ", low latency" : ", no low latency") : "";
+	return str;
+}
+
+void printCandidate(std::string const& label, Candidate const& candidate) {
+	auto us = [](std::chrono::nanoseconds d) { return std::chrono::duration<double, std::micro>{d}.count(); };
+	for (auto const& m : candidate.measurements) {
+		std::cout << std::left << std::setw(34) << label + " (" + describe(candidate.settings) + ")" << std::right << std::fixed << std::setprecision(0)
+		          << std::setw(8) << m.payload << std::setw(10) << us(m.p50) << std::setw(10) << us(m.p90) << std::setw(10) << us(m.p99)
+		          << std::setw(10) << us(m.max) << std::setw(10) << m.timeouts << "\n";
+	}
+}
+
+void printHeader() {
+	std::cout << std::left << std::setw(34) << "settings" << std::right << std::setw(8) << "payload" << std::setw(10) << "p50[us]"
+	          << std::setw(10) << "p90[us]" << std::setw(10) << "p99[us]" << std::setw(10) << "max[us]" << std::setw(10) << "timeouts" << "\n";
+}
+
+void runTune() {
+	auto timeout = std::chrono::microseconds{*g_timeout};
+	auto usb2dyn = USB2Dynamixel(*g_baudrate, *g_device, *g_protocolVersion, false);
+
+	std::set<int> ids = *optIDs;
+	if (g_id) {
+		ids = {*g_id};
+	}
+	auto [layout, motors] = detectMotorsOfOneLayout(ids, usb2dyn, timeout);
+	auto motor = motors.front();
+	std::size_t layoutLength {0};
+	meta::forAllLayoutTypes([&, layout = layout](auto const& info) {
+		using Info = std::decay_t<decltype(info)>;
+		if (Info::Type == layout) {
+			layoutLength = Info::FullLayout::Length;
+		}
+	});
+	std::vector<std::size_t> payloads;
+	for (auto payload : *optPayloads) {
+		if (payload > 0 and std::size_t(payload) <= layoutLength) {
+			payloads.push_back(payload);
+		}
+	}
+	if (payloads.empty()) {
+		throw std::runtime_error("no payload fits into the register table (" + std::to_string(layoutLength) + " bytes) of motor " + std::to_string(motor));
+	}
+
+	auto adapter  = adapter::identify(*g_device);
+	auto original = adapter::readSettings(adapter);
+	std::cout << "adapter " << adapter.id << " (" << adapter.device << "), measuring with motor " << int(motor) << "\n";
+
+	auto baseline = driverDefaults(original);
+	try {
+		adapter::applySettings(adapter, baseline);
+	} catch (std::exception const& e) {
+		std::cout << "cannot restore the driver defaults (" << e.what() << "), measuring \"before\" with the current settings\n";
+		baseline = adapter::readSettings(adapter);
+	}
+	auto before = Candidate{baseline, measure(usb2dyn, motor, payloads, timeout)};
+
+	// from the least to the most aggressive setting, a more aggressive one has to be noticeably better to be chosen
+	auto flags  = original.lowLatency ? std::vector<std::optional<bool>>{false, true} : std::vector<std::optional<bool>>{std::nullopt};
+	auto timers = std::vector<std::optional<int>>{std::nullopt};
+	if (original.latencyTimer) {
+		timers.clear();
+		for (auto timer : *optTimers) {
+			if (timer >= 1 and timer <= 255) {
+				timers.push_back(timer);
+			}
+		}
+	}
+	std::vector<adapter::Settings> settings;
+	for (auto flag : flags) {
+		for (auto timer : timers) {
+			if (flag or timer) {
+				settings.push_back({timer, flag});
+			}
+		}
+	}
+	std::vector<Candidate> candidates;
+	for (auto const& s : settings) {
+		try {
+			adapter::applySettings(adapter, s);
+		} catch (std::exception const& e) {
+			std::cout << "skipping " << describe(s) << ": " << e.what() << "\n";
+			continue;
+		}
+		candidates.push_back({s, measure(usb2dyn, motor, payloads, timeout)});
+	}
+
+	printHeader();
+	printCandidate("before", before);
+	for (auto const& candidate : candidates) {
+		printCandidate("candidate", candidate);
+	}
+
+	if (candidates.empty()) {
+		std::cout << "none of the adapter settings can be changed, " << (original.latencyTimer ? "" : "it has no latency_timer, ")
+		          << (original.lowLatency ? "" : "it has no low latency flag, ") << "nothing to tune\n";
+		return;
+	}
+
+	auto best = std::min_element(candidates.begin(), candidates.end(), [](auto const& l, auto const& r) { return l.score() < r.score(); });
+	auto chosen = std::find_if(candidates.begin(), candidates.end(), [&](auto const& c) { return c.score() <= best->score() * 105 / 100; });
+	adapter::applySettings(adapter, chosen->settings);
+
+	std::cout << "\n";
+	printHeader();
+	printCandidate("before", before);
+	printCandidate("after", *chosen);
+
+	if (optNoSave) {
+		std::cout << "applied " << describe(chosen->settings) << ", not saved\n";
+		return;
+	}
+	adapter::saveProfile(adapter.id, chosen->settings);
+	std::cout << "saved " << adapter::to_string(chosen->settings) << " for " << adapter.id << " in " << adapter::profilePath() << "\n";
+}
+
+}
@@ -0,0 +1,223 @@
+#include "AdapterProfile.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include <fcntl.h>
+#include <linux/serial.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+namespace dynamixel::adapter {
+namespace {
+
+namespace fs = std::filesystem;
+
+auto readLine(fs::path const& path) -> std::optional<std::string> {
+	std::ifstream file{path};
+	std::string line;
+	if (not file or not std::getline(file, line)) {
+		return std::nullopt;
+	}
+	return line;
+}
+
+// the port wide flag can be changed through any file descriptor of the tty
+auto withSerialInfo(std::string const& device, bool write, bool lowLatency) -> std::optional<bool> {
+	int fd = ::open(device.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+	if (fd < 0) {
+		return std::nullopt;
+	}
+	struct serial_struct serial;
+	std::memset(&serial, 0, sizeof(serial));
+	if (0 > ioctl(fd, TIOCGSERIAL, &serial)) {
+		::close(fd);
+		return std::nullopt;
+	}
+	if (write) {
+		serial.flags = lowLatency ? (serial.flags | ASYNC_LOW_LATENCY) : (serial.flags & ~ASYNC_LOW_LATENCY);
+		if (0 > ioctl(fd, TIOCSSERIAL, &serial)) {
+			auto error = std::string{strerror(errno)};
+			::close(fd);
+			throw std::runtime_error("cannot do TIOCSSERIAL on " + device + " " + error);
+		}
+	}
+	::close(fd);
+	return (serial.flags & ASYNC_LOW_LATENCY) != 0;
+}
+
+auto parseProfile(std::string const& line) -> std::pair<std::string, Settings> {
+	std::stringstream ss{line};
+	std::string id;
+	ss >> id;
+	Settings settings;
+	std::string field;
+	while (ss >> field) {
+		auto eq = field.find('=');
+		if (eq == std::string::npos) {
+			continue;
+		}
+		auto key   = field.substr(0, eq);
+		auto value = std::atoi(field.substr(eq + 1).c_str());
+		if (key == "latency_timer") {
+			settings.latencyTimer = value;
+		} else if (key == "low_latency") {
+			settings.lowLatency = value != 0;
+		}
+	}
+	return {id, settings};
+}
+
+}
+
+auto identify(std::string const& device) -> Adapter {
+	Adapter adapter;
+	std::error_code ec;
+	auto canonical = fs::canonical(device, ec);
+	adapter.device = ec ? device : canonical.string();
+	adapter.id     = adapter.device;
+
+	auto sysfs = fs::path{"/sys/class/tty"} / fs::path{adapter.device}.filename() / "device";
+	if (not fs::exists(sysfs, ec)) {
+		return adapter;
+	}
+	adapter.sysfs = sysfs.string();
+	// the usb device (with its ids) is a parent of the usb-serial port
+	for (auto dir = fs::canonical(sysfs, ec); not ec and dir.has_relative_path(); dir = dir.parent_path()) {
+		auto vendor  = readLine(dir / "idVendor");
+		auto product = readLine(dir / "idProduct");
+		if (vendor and product) {
+			adapter.id = *vendor + ":" + *product + ":" + readLine(dir / "serial").value_or(dir.filename().string());
+			break;
+		}
+	}
+	return adapter;
+}
+
+auto readSettings(Adapter const& adapter) -> Settings {
+	Settings settings;
+	if (not adapter.sysfs.empty()) {
+		if (auto timer = readLine(fs::path{adapter.sysfs} / "latency_timer")) {
+			settings.latencyTimer = std::atoi(timer->c_str());
+		}
+	}
+	settings.lowLatency = withSerialInfo(adapter.device, false, false);
+	return settings;
+}
+
+void applySettings(Adapter const& adapter, Settings const& settings) {
+	if (settings.lowLatency) {
+		if (not withSerialInfo(adapter.device, true, *settings.lowLatency)) {
+			throw std::runtime_error(adapter.device + " has no low latency flag");
+		}
+	}
+	if (settings.latencyTimer) {
+		if (adapter.sysfs.empty()) {
+			throw std::runtime_error(adapter.device + " has no latency timer in sysfs");
+		}
+		auto path = fs::path{adapter.sysfs} / "latency_timer";
+		std::ofstream file{path};
+		if (not (file << *settings.latencyTimer << std::flush)) {
+			throw std::runtime_error("cannot write " + path.string() + " (root or a udev rule is needed to change it)");
+		}
+	}
+}
+
+auto profilePath() -> std::string {
+	if (auto config = std::getenv("XDG_CONFIG_HOME"); config and *config) {
+		return std::string{config} + "/inspexel/adapters";
+	}
+	if (auto home = std::getenv("HOME"); home and *home) {
+		return std::string{home} + "/.config/inspexel/adapters";
+	}
+	return "";
+}
+
+auto loadProfile(std::string const& id) -> std::optional<Settings> {
+	auto path = profilePath();
+	if (path.empty()) {
+		return std::nullopt;
+	}
+	std::ifstream file{path};
+	std::string line;
+	while (std::getline(file, line)) {
+		auto [lineID, settings] = parseProfile(line);
+		if (lineID == id) {
+			return settings;
+		}
+	}
+	return std::nullopt;
+}
+
+void saveProfile(std::string const& id, Settings const& settings) {
+	auto path = profilePath();
+	if (path.empty()) {
+		throw std::runtime_error("neither XDG_CONFIG_HOME nor HOME are set, cannot save the adapter profile");
+	}
+	std::vector<std::string> lines;
+	{
+		std::ifstream file{path};
+		std::string line;
+		while (std::getline(file, line)) {
+			if (not line.empty() and parseProfile(line).first != id) {
+				lines.push_back(line);
+			}
+		}
+	}
+	lines.push_back(id + " " + to_string(settings));
+
+	fs::create_directories(fs::path{path}.parent_path());
+	std::ofstream file{path, std::ios::trunc};
+	for (auto const& line : lines) {
+		file << line << "\n";
+	}
+	if (not file.flush()) {
+		throw std::runtime_error("cannot write " + path);
+	}
+}
+
+void applyProfile(std::string const& device) {
+	auto path = profilePath();
+	std::error_code ec;
+	if (path.empty() or not fs::exists(path, ec)) {
+		return;
+	}
+	auto adapter  = identify(device);
+	auto settings = loadProfile(adapter.id);
+	if (not settings) {
+		return;
+	}
+	auto current = readSettings(adapter);
+	// only touch what differs, writing sysfs might need privileges the caller does not have
+	if (current.latencyTimer == settings->latencyTimer) {
+		settings->latencyTimer.reset();
+	}
+	if (current.lowLatency == settings->lowLatency) {
+		settings->lowLatency.reset();
+	}
+	try {
+		applySettings(adapter, *settings);
+	} catch (std::exception const& e) {
+		std::cout << "cannot apply the adapter profile of " << adapter.id << ": " << e.what() << "\n";
+	}
+}
+
+auto to_string(Settings const& settings) -> std::string {
+	std::string str;
+	if (settings.latencyTimer) {
+		str += "latency_timer=" + std::to_string(*settings.latencyTimer);
+	}
+	if (settings.lowLatency) {
+		str += std::string{str.empty() ? "" : " "} + "low_latency=" + (*settings.lowLatency ? "1" : "0");
+	}
+	return str;
+}
+
+}
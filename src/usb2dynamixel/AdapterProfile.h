@@ -0,0 +1,46 @@
+#pragma once
+
+#include <optional>
+#include <string>
+
+/**
+ * settings of the usb serial adapter that dominate the round trip time
+ *
+ * FTDI based adapters (USB2Dynamixel, U2D2) collect received bytes for latency_timer ms (default 16) before they
+ * hand them to the host, unless their buffer is full. The timer is set through sysfs, the serial driver's
+ * ASYNC_LOW_LATENCY flag through TIOCSSERIAL. The USB transfer size is fixed by the Linux driver.
+ *
+ * profiles (written by "inspexel tune") are stored one adapter per line in $XDG_CONFIG_HOME/inspexel/adapters
+ * (default: ~/.config/inspexel/adapters):
+ *   <adapter id> latency_timer=<ms> low_latency=<0|1>
+ */
+namespace dynamixel::adapter {
+
+struct Settings {
+	std::optional<int>  latencyTimer; // ms, only FTDI adapters have one
+	std::optional<bool> lowLatency;   // only real serial drivers have the flag (e.g. not the pty of "inspexel simulate")
+};
+
+struct Adapter {
+	std::string device; // canonical path of the tty
+	std::string id;     // <vendor>:<product>:<serial> of the usb device, the device path if it is no usb adapter
+	std::string sysfs;  // /sys/class/tty/<name>/device, empty if there is none
+};
+
+[[nodiscard]] auto identify(std::string const& device) -> Adapter;
+// the current settings, unsupported ones are missing
+[[nodiscard]] auto readSettings(Adapter const& adapter) -> Settings;
+// applies the given settings (missing ones are left alone), throws if that is not possible (e.g. no permission)
+void applySettings(Adapter const& adapter, Settings const& settings);
+
+[[nodiscard]] auto profilePath() -> std::string;
+[[nodiscard]] auto loadProfile(std::string const& id) -> std::optional<Settings>;
+// adds or replaces the profile of id
+void saveProfile(std::string const& id, Settings const& settings);
+
+// applies the saved profile of the adapter behind device (if there is one), failures are reported but not thrown
+void applyProfile(std::string const& device);
+
+[[nodiscard]] auto to_string(Settings const& settings) -> std::string;
+
+}
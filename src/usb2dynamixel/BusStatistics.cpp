@@ -0,0 +1,132 @@
+#include "BusStatistics.h"
+
+namespace dynamixel {
+namespace {
+
+void add(BusStatistics::Counters& counters, BusStatistics::Reception const& r) {
+	counters.bytesRx.fetch_add(r.receive.bytes, std::memory_order_relaxed);
+	counters.resyncs.fetch_add(r.receive.resyncs, std::memory_order_relaxed);
+	counters.checksumFailures.fetch_add(r.receive.checksumFailures, std::memory_order_relaxed);
+	if (r.timeout) {
+		counters.timeouts.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+	for (int bit{0}; bit < 8; ++bit) {
+		if (uint8_t(r.errorCode) & (1 << bit)) {
+			counters.errorBits[bit].fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+	counters.latency.record(r.latency);
+}
+
+void printCounters(std::ostream& os, std::string const& scope, BusStatistics::Counters const& c) {
+	auto us = [](std::chrono::nanoseconds d) { return std::chrono::duration<double, std::micro>{d}.count(); };
+	os << "scope=" << scope
+	   << " transactions=" << c.transactions.load(std::memory_order_relaxed)
+	   << " bytes_tx=" << c.bytesTx.load(std::memory_order_relaxed)
+	   << " bytes_rx=" << c.bytesRx.load(std::memory_order_relaxed)
+	   << " timeouts=" << c.timeouts.load(std::memory_order_relaxed)
+	   << " checksum_failures=" << c.checksumFailures.load(std::memory_order_relaxed)
+	   << " resyncs=" << c.resyncs.load(std::memory_order_relaxed)
+	   << " error_bits=";
+	for (int bit{0}; bit < 8; ++bit) {
+		os << (bit ? "," : "") << c.errorBits[bit].load(std::memory_order_relaxed);
+	}
+	os << " latency_us_p50=" << us(c.latency.percentile(.5))
+	   << " latency_us_p90=" << us(c.latency.percentile(.9))
+	   << " latency_us_p99=" << us(c.latency.percentile(.99))
+	   << " latency_us_max=" << us(c.latency.max())
+	   << " latency_us_mean=" << us(c.latency.mean()) << "\n";
+}
+
+}
+
+void BusStatistics::Counters::reset() noexcept {
+	for (auto* counter : {&transactions, &bytesTx, &bytesRx, &timeouts, &checksumFailures, &resyncs}) {
+		counter->store(0, std::memory_order_relaxed);
+	}
+	for (auto& bit : errorBits) {
+		bit.store(0, std::memory_order_relaxed);
+	}
+	latency.reset();
+}
+
+auto BusStatistics::Table::get(uint8_t index) -> Counters& {
+	auto& slot = slots[index];
+	auto counters = slot.load(std::memory_order_acquire);
+	if (not counters) {
+		auto fresh = new Counters{};
+		// someone else might have been faster
+		if (slot.compare_exchange_strong(counters, fresh, std::memory_order_acq_rel)) {
+			counters = fresh;
+		} else {
+			delete fresh;
+		}
+	}
+	return *counters;
+}
+
+BusStatistics::Table::~Table() {
+	for (auto& slot : slots) {
+		delete slot.load();
+	}
+}
+
+BusStatistics::~BusStatistics() = default;
+
+void BusStatistics::sent(Instruction instruction, MotorID motor, std::size_t bytes) {
+	auto count = [&](Counters& counters) {
+		counters.transactions.fetch_add(1, std::memory_order_relaxed);
+		counters.bytesTx.fetch_add(bytes, std::memory_order_relaxed);
+	};
+	count(mTotal);
+	count(mInstructions.get(uint8_t(instruction)));
+	if (motor != BroadcastID and motor != MotorIDInvalid) {
+		count(mMotors.get(motor));
+	}
+}
+
+void BusStatistics::received(Instruction instruction, Reception const& reception) {
+	add(mTotal, reception);
+	add(mInstructions.get(uint8_t(instruction)), reception);
+	auto& motor = mMotors.get(reception.motor);
+	add(motor, reception);
+	if (reception.broadcast) {
+		motor.transactions.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+auto BusStatistics::byInstruction(Instruction instruction) const noexcept -> Counters const* {
+	return mInstructions.slots[uint8_t(instruction)].load(std::memory_order_acquire);
+}
+
+auto BusStatistics::byMotor(MotorID motor) const noexcept -> Counters const* {
+	return mMotors.slots[motor].load(std::memory_order_acquire);
+}
+
+void BusStatistics::reset() noexcept {
+	mTotal.reset();
+	for (auto* table : {&mInstructions, &mMotors}) {
+		for (auto& slot : table->slots) {
+			if (auto counters = slot.load(std::memory_order_acquire)) {
+				counters->reset();
+			}
+		}
+	}
+}
+
+void BusStatistics::print(std::ostream& os) const {
+	printCounters(os, "total", mTotal);
+	for (int i{0}; i < 256; ++i) {
+		if (auto counters = byInstruction(Instruction(i))) {
+			printCounters(os, "instruction:" + to_string(Instruction(i)), *counters);
+		}
+	}
+	for (int i{0}; i < 256; ++i) {
+		if (auto counters = byMotor(MotorID(i))) {
+			printCounters(os, "motor:" + std::to_string(i), *counters);
+		}
+	}
+}
+
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "dynamixel.h"
+#include "LatencyHistogram.h"
+#include "ProtocolBase.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <ostream>
+#include <string>
+
+namespace dynamixel {
+
+/**
+ * counters and latency histograms of everything that went over the bus, in total, per instruction and per motor
+ * recording is lock free (relaxed atomics) so the statistics can be read while the bus is busy,
+ * counters of an instruction or motor are allocated the first time something is recorded for them
+ */
+struct BusStatistics {
+	struct Counters {
+		std::atomic<uint64_t> transactions     {0}; // instruction packets sent (per motor: instructions addressed to it and its part of sync/bulk reads)
+		std::atomic<uint64_t> bytesTx          {0};
+		std::atomic<uint64_t> bytesRx          {0};
+		std::atomic<uint64_t> timeouts         {0}; // expected status packets that did not arrive
+		std::atomic<uint64_t> checksumFailures {0};
+		std::atomic<uint64_t> resyncs          {0};
+		std::array<std::atomic<uint64_t>, 8> errorBits {}; // status packets with bit i of the error byte set
+		LatencyHistogram      latency;                      // from sending the instruction until the status packet was received
+
+		void reset() noexcept;
+	};
+
+	// everything that happened while waiting for one status packet
+	struct Reception {
+		MotorID                  motor;
+		bool                     timeout;
+		ErrorCode                errorCode;
+		std::chrono::nanoseconds latency;
+		bool                     broadcast; // the instruction was a broadcast (sync/bulk read), count it as a transaction of the motor
+		ProtocolBase::ReceiveStatistics receive; // what the protocol saw while receiving this packet
+	};
+
+	BusStatistics() = default;
+	BusStatistics(BusStatistics const&) = delete;
+	auto operator=(BusStatistics const&) -> BusStatistics& = delete;
+	~BusStatistics();
+
+	void sent(Instruction instruction, MotorID motor, std::size_t bytes);
+	void received(Instruction instruction, Reception const& reception);
+
+	[[nodiscard]] auto total() const noexcept -> Counters const& { return mTotal; }
+	// nullptr if nothing was recorded for instruction or motor yet
+	[[nodiscard]] auto byInstruction(Instruction instruction) const noexcept -> Counters const*;
+	[[nodiscard]] auto byMotor(MotorID motor) const noexcept -> Counters const*;
+
+	void reset() noexcept;
+
+	/**
+	 * one line per scope (total, every used instruction, every seen motor) of key=value pairs:
+	 * scope=motor:3 transactions=.. bytes_tx=.. bytes_rx=.. timeouts=.. checksum_failures=.. resyncs=..
+	 *   error_bits=b0,..,b7 latency_us_p50=.. latency_us_p90=.. latency_us_p99=.. latency_us_max=.. latency_us_mean=..
+	 */
+	void print(std::ostream& os) const;
+
+private:
+	struct Table {
+		std::array<std::atomic<Counters*>, 256> slots {};
+		auto get(uint8_t index) -> Counters&;
+		~Table();
+	};
+
+	Counters mTotal;
+	Table    mInstructions;
+	Table    mMotors;
+};
+
+}
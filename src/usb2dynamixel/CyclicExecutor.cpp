@@ -0,0 +1,103 @@
+#include "CyclicExecutor.h"
+
+#include <simplyfile/ThreadTime.h>
+#include <simplyfile/Timer.h>
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+
+namespace dynamixel {
+
+CyclicExecutor::CyclicExecutor(USB2Dynamixel const& usb2dyn, std::vector<MotorID> motors, TelemetryFrame frame, int commandRegister, Options options)
+	: mUsb2Dyn(usb2dyn)
+	, mMotors(std::move(motors))
+	, mFrame(std::move(frame))
+	, mCommandRegister(commandRegister)
+	, mOptions(std::move(options))
+{
+	if (mOptions.period <= std::chrono::nanoseconds{0}) {
+		throw std::runtime_error("the period of a cyclic executor must be positive");
+	}
+	if (mMotors.empty()) {
+		throw std::runtime_error("a cyclic executor needs at least one motor");
+	}
+	mFrame.resize(mMotors.size());
+}
+
+// failing to get real time properties is not fatal (e.g. missing privileges), the loop just runs with more jitter
+void CyclicExecutor::applyRealTimeSettings() const {
+	if (mOptions.lockMemory and ::mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+		std::cout << "cannot lock memory: " << strerror(errno) << std::endl;
+	}
+	if (not mOptions.cpus.empty()) {
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		for (auto cpu : mOptions.cpus) {
+			CPU_SET(cpu, &set);
+		}
+		if (int err = ::pthread_setaffinity_np(::pthread_self(), sizeof(set), &set); err != 0) {
+			std::cout << "cannot set cpu affinity: " << strerror(err) << std::endl;
+		}
+	}
+	if (mOptions.priority) {
+		struct sched_param param {};
+		param.sched_priority = *mOptions.priority;
+		if (int err = ::pthread_setschedparam(::pthread_self(), SCHED_FIFO, &param); err != 0) {
+			std::cout << "cannot set SCHED_FIFO priority " << *mOptions.priority << ": " << strerror(err) << std::endl;
+		}
+	}
+}
+
+void CyclicExecutor::run(Callback const& callback, std::atomic<bool> const& stop) {
+	applyRealTimeSettings();
+
+	std::map<MotorID, Parameter> commands;
+	auto const cpuStart = simplyfile::getThreadTime();
+
+	// a blocking timer, every read returns after the next expiration
+	auto timer    = simplyfile::Timer{mOptions.period, false, 0};
+	auto expected = std::chrono::steady_clock::now() + mOptions.period;
+	while (not stop) {
+		int expirations = timer.getElapsed();
+		auto wakeup = std::chrono::steady_clock::now();
+		if (expirations <= 0) {
+			continue;
+		}
+		// expected is the expiration of the last period that elapsed
+		expected += mOptions.period * (expirations - 1);
+		auto jitter = std::max(std::chrono::nanoseconds{0}, std::chrono::duration_cast<std::chrono::nanoseconds>(wakeup - expected));
+		expected += mOptions.period;
+
+		mUsb2Dyn.sync_read(mMotors, mFrame, mOptions.timeout);
+		commands.clear();
+		callback(mFrame, commands);
+		if (not commands.empty()) {
+			mUsb2Dyn.sync_write(commands, mCommandRegister);
+		}
+
+		auto cycleTime = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - wakeup);
+		auto g = std::lock_guard(mStatsMutex);
+		mStats.cycles          += 1;
+		mStats.overruns        += expirations - 1;
+		mStats.deadlineMisses  += (jitter + cycleTime > mOptions.period);
+		mStats.incompleteReads += (mFrame.motors.size() != mMotors.size());
+		mStats.maxJitter        = std::max(mStats.maxJitter, jitter);
+		mStats.totalJitter     += jitter;
+		mStats.maxCycleTime     = std::max(mStats.maxCycleTime, cycleTime);
+		mStats.totalCycleTime  += cycleTime;
+		mStats.cpuTime          = simplyfile::getThreadTime() - cpuStart;
+	}
+}
+
+auto CyclicExecutor::getStats() const -> Stats {
+	auto g = std::lock_guard(mStatsMutex);
+	return mStats;
+}
+
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "USB2Dynamixel.h"
+#include "TelemetryFrame.h"
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <vector>
+
+namespace dynamixel {
+
+/**
+ * runs "read state -> callback -> write commands" cycles at a fixed rate
+ *
+ * every cycle is woken up by a timerfd, reads frame with one sync_read, hands it to the callback
+ * and writes the commands the callback produced with one sync_write.
+ * run() executes in the calling thread and optionally makes it a real time thread (SCHED_FIFO, cpu affinity, locked memory).
+ */
+struct CyclicExecutor {
+	struct Options {
+		std::chrono::nanoseconds period     {std::chrono::milliseconds{2}};
+		USB2Dynamixel::Timeout   timeout    {std::chrono::microseconds{500}}; // per status packet
+		std::optional<int>       priority;   // SCHED_FIFO priority (1..99)
+		std::set<int>            cpus;       // pin the thread to these cpus
+		bool                     lockMemory {false};
+	};
+
+	struct Stats {
+		uint64_t                 cycles          {0};
+		uint64_t                 overruns        {0}; // timer periods that passed without a cycle
+		uint64_t                 deadlineMisses  {0}; // cycles that took longer than one period
+		uint64_t                 incompleteReads {0}; // cycles in which not all motors answered
+		std::chrono::nanoseconds maxJitter       {0}; // wake up delay after the timer expired
+		std::chrono::nanoseconds totalJitter     {0};
+		std::chrono::nanoseconds maxCycleTime    {0};
+		std::chrono::nanoseconds totalCycleTime  {0};
+		std::chrono::nanoseconds cpuTime         {0}; // cpu time spent by the cycle thread
+	};
+
+	// commands maps motors to the data written to commandRegister, it is cleared before every cycle
+	using Callback = std::function<void(TelemetryFrame const& state, std::map<MotorID, Parameter>& commands)>;
+
+	CyclicExecutor(USB2Dynamixel const& usb2dyn, std::vector<MotorID> motors, TelemetryFrame frame, int commandRegister, Options options);
+
+	// run cycles until stop becomes true
+	void run(Callback const& callback, std::atomic<bool> const& stop);
+
+	// can be called from any thread while run() is executing
+	[[nodiscard]] auto getStats() const -> Stats;
+
+private:
+	void applyRealTimeSettings() const;
+
+	USB2Dynamixel const& mUsb2Dyn;
+	std::vector<MotorID> mMotors;
+	TelemetryFrame       mFrame;
+	int                  mCommandRegister;
+	Options              mOptions;
+
+	mutable std::mutex   mStatsMutex;
+	Stats                mStats;
+};
+
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace dynamixel {
+
+/**
+ * lock free histogram of durations with a bounded relative error (HDR style)
+ *
+ * every power of two range of nanoseconds is split into SubBuckets linear buckets, so a recorded value
+ * is off by at most 1/SubBuckets (6.25%), values up to 2^MaxExponent ns (about 18 minutes) are distinguished
+ * record() is wait free (relaxed atomics), readers may see a histogram that is being updated
+ */
+struct LatencyHistogram {
+	static constexpr int SubBucketBits = 4;
+	static constexpr int SubBuckets    = 1 << SubBucketBits;
+	static constexpr int MaxExponent   = 40;
+	static constexpr int BucketCount   = (MaxExponent - SubBucketBits + 2) * SubBuckets;
+
+	void record(std::chrono::nanoseconds duration) noexcept {
+		auto value = uint64_t(std::max<int64_t>(0, duration.count()));
+		mBuckets[bucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+		mCount.fetch_add(1, std::memory_order_relaxed);
+		mSum.fetch_add(value, std::memory_order_relaxed);
+		auto max = mMax.load(std::memory_order_relaxed);
+		while (value > max and not mMax.compare_exchange_weak(max, value, std::memory_order_relaxed)) {}
+	}
+
+	[[nodiscard]] auto count() const noexcept -> uint64_t { return mCount.load(std::memory_order_relaxed); }
+	[[nodiscard]] auto max() const noexcept -> std::chrono::nanoseconds { return std::chrono::nanoseconds{mMax.load(std::memory_order_relaxed)}; }
+	[[nodiscard]] auto mean() const noexcept -> std::chrono::nanoseconds {
+		auto n = count();
+		return std::chrono::nanoseconds{n ? int64_t(mSum.load(std::memory_order_relaxed) / n) : 0};
+	}
+
+	// smallest recorded duration that is not exceeded by the fraction p (0..1) of all recorded durations (upper bound of its bucket)
+	[[nodiscard]] auto percentile(double p) const noexcept -> std::chrono::nanoseconds {
+		auto n = count();
+		if (n == 0) {
+			return std::chrono::nanoseconds{0};
+		}
+		auto rank = uint64_t(p * n + .5);
+		rank = std::min(std::max<uint64_t>(rank, 1), n);
+		uint64_t seen {0};
+		for (int i{0}; i < BucketCount; ++i) {
+			seen += mBuckets[i].load(std::memory_order_relaxed);
+			if (seen >= rank) {
+				return std::min(std::chrono::nanoseconds{int64_t(upperBoundOf(i))}, max());
+			}
+		}
+		return max();
+	}
+
+	void reset() noexcept {
+		for (auto& bucket : mBuckets) {
+			bucket.store(0, std::memory_order_relaxed);
+		}
+		mCount.store(0, std::memory_order_relaxed);
+		mSum.store(0, std::memory_order_relaxed);
+		mMax.store(0, std::memory_order_relaxed);
+	}
+
+	[[nodiscard]] static constexpr auto bucketOf(uint64_t value) noexcept -> int {
+		if (value < SubBuckets) {
+			return int(value);
+		}
+		int exponent = 63 - __builtin_clzll(value);
+		if (exponent > MaxExponent) {
+			return BucketCount - 1;
+		}
+		int sub = int(value >> (exponent - SubBucketBits)) & (SubBuckets - 1);
+		return (exponent - SubBucketBits + 1) * SubBuckets + sub;
+	}
+
+	// largest value that falls into bucket
+	[[nodiscard]] static constexpr auto upperBoundOf(int bucket) noexcept -> uint64_t {
+		if (bucket < SubBuckets) {
+			return uint64_t(bucket);
+		}
+		int exponent = bucket / SubBuckets + SubBucketBits - 1;
+		int sub      = bucket % SubBuckets;
+		return ((uint64_t(SubBuckets + sub + 1)) << (exponent - SubBucketBits)) - 1;
+	}
+
+private:
+	std::array<std::atomic<uint64_t>, BucketCount> mBuckets {};
+	std::atomic<uint64_t> mCount {0};
+	std::atomic<uint64_t> mSum   {0};
+	std::atomic<uint64_t> mMax   {0};
+};
+
+}
@@ -4,7 +4,9 @@
 #include <cstddef>
 #include <cstring>
 #include <functional>
+#include <limits>
 #include <map>
+#include <optional>
 #include <vector>
 #include <stdexcept>
 
@@ -140,10 +142,81 @@ inline auto to_string(LayoutField::Access access) -> std::string {
 	throw std::runtime_error("unknown access value");
 }
 
+/**
+ * affine mapping between raw register values and SI units:
+ *   si  = (raw - center) * resolution
+ *   raw = clamp(round(si / resolution + center), minValue, maxValue)
+ *
+ * if signBit is set the raw values are sign-magnitude encoded (e.g. the speed registers of MX_V1 motors)
+ * this is a plain literal type so conversions can be inlined and the batch versions can be vectorized
+ */
+struct AffineConvert {
+	double resolution {1.};
+	int    center     {0};
+	int    minValue   {std::numeric_limits<int>::min()};
+	int    maxValue   {std::numeric_limits<int>::max()};
+	int    signBit    {0};
+
+	[[nodiscard]] constexpr auto toMotor(double val) const -> int {
+		double raw = std::clamp(val / resolution + center, double(minValue), double(maxValue));
+		return raw >= 0. ? int(raw + .5) : int(raw - .5);
+	}
+
+	[[nodiscard]] constexpr auto fromMotor(int val) const -> double {
+		if (signBit != 0 and (val & signBit)) {
+			val = -(val & (signBit-1));
+		}
+		return (val - center) * resolution;
+	}
+
+	void toMotor(double const* in, int32_t* out, std::size_t count) const {
+		for (std::size_t i{0}; i < count; ++i) {
+			out[i] = toMotor(in[i]);
+		}
+	}
+
+	void fromMotor(int32_t const* in, double* out, std::size_t count) const {
+		if (signBit == 0) {
+			for (std::size_t i{0}; i < count; ++i) {
+				out[i] = (in[i] - center) * resolution;
+			}
+		} else {
+			int32_t const magnitudeMask = signBit-1;
+			for (std::size_t i{0}; i < count; ++i) {
+				int32_t magnitude = in[i] & magnitudeMask;
+				int32_t val = (in[i] & signBit) ? -magnitude : in[i];
+				out[i] = (val - center) * resolution;
+			}
+		}
+	}
+
+	void toMotor(std::vector<double> const& in, std::vector<int32_t>& out) const {
+		out.resize(in.size());
+		toMotor(in.data(), out.data(), in.size());
+	}
+
+	void fromMotor(std::vector<int32_t> const& in, std::vector<double>& out) const {
+		out.resize(in.size());
+		fromMotor(in.data(), out.data(), in.size());
+	}
+};
+
 struct Convert {
 	std::string unit;
-	std::function<int(double)> toMotor;
-	std::function<double(int)> fromMotor;
+	std::optional<AffineConvert> affine;
+
+	explicit operator bool() const { return affine.has_value(); }
+
+	[[nodiscard]] auto toMotor(double val) const -> int { return get().toMotor(val); }
+	[[nodiscard]] auto fromMotor(int val) const -> double { return get().fromMotor(val); }
+
+private:
+	[[nodiscard]] auto get() const -> AffineConvert const& {
+		if (not affine) {
+			throw std::runtime_error("register has no unit conversion");
+		}
+		return *affine;
+	}
 };
 
 template <typename Reg>
@@ -164,11 +237,10 @@ struct Info {
 	DefaultLayout<Register> defaultLayout;
 };
 
-inline auto buildConverter(std::string unit, double resolution, int centerVal=0, int minValue=std::numeric_limits<int>::min(), int maxValue = std::numeric_limits<int>::max()) -> Convert {
+inline auto buildConverter(std::string unit, double resolution, int centerVal=0, int minValue=std::numeric_limits<int>::min(), int maxValue = std::numeric_limits<int>::max(), int signBit=0) -> Convert {
 	return Convert{
 		unit,
-		[=](double val) { return std::clamp(int(std::round(val / resolution + centerVal)), minValue, maxValue); },
-		[=](int val)    { return (val - centerVal) * resolution; },
+		AffineConvert{resolution, centerVal, minValue, maxValue, signBit},
 	};
 }
 
@@ -23,6 +23,15 @@ struct ProtocolBase {
 	using Timeout = std::chrono::high_resolution_clock::duration;
 	virtual ~ProtocolBase() {}
 
+	// what the receive path had to deal with, the counters only increase
+	// not synchronized: the owner of the port serializes all readPacket calls anyway
+	struct ReceiveStatistics {
+		uint64_t bytes            {0};
+		uint64_t resyncs          {0}; // readPacket calls that had to skip bytes or foreign packets to find the expected header
+		uint64_t checksumFailures {0}; // received packets that failed validation (checksum or length)
+	};
+	[[nodiscard]] auto getReceiveStatistics() const -> ReceiveStatistics { return mReceiveStatistics; }
+
 	[[nodiscard]] virtual auto createPacket(MotorID motorID, Instruction instr, Parameter data) const -> Parameter = 0;
 	/**
 	 * receive a packet that contains numParameters bytes of payload
@@ -47,6 +56,10 @@ struct ProtocolBase {
 	[[nodiscard]] virtual auto convertAddress(int addr) const -> Parameter = 0;
 
 	[[nodiscard]] virtual auto buildBulkReadPackage(std::vector<std::tuple<MotorID, int, size_t>> const& motors) const -> std::vector<std::byte> = 0;
+	[[nodiscard]] virtual auto buildBulkWritePackage(std::vector<std::tuple<MotorID, int, Parameter>> const& motors) const -> std::vector<std::byte> = 0;
+
+protected:
+	mutable ReceiveStatistics mReceiveStatistics;
 };
 
 }
@@ -6,10 +6,9 @@
 
 
 namespace dynamixel {
-namespace {
+namespace detail::v1 {
 
-[[nodiscard]]
-std::byte calculateChecksum(Parameter const& packet) {
+auto calculateChecksum(Parameter const& packet) -> std::byte {
 	uint32_t checkSum = 0;
 	for (size_t i(2); i < packet.size(); ++i) {
 		checkSum += uint8_t(packet[i]);
@@ -17,7 +16,6 @@ std::byte calculateChecksum(Parameter const& packet) {
 	return std::byte(~checkSum);
 }
 
-[[nodiscard]]
 bool validatePacket(Parameter const& rxBuf) {
 	if (rxBuf.size() > 255) {
 		return false;
@@ -39,6 +37,7 @@ bool validatePacket(Parameter const& rxBuf) {
 }
 
 }
+using namespace detail::v1;
 
 auto ProtocolV1::createPacket(MotorID motorID, Instruction instr, Parameter data) const -> Parameter {
 	if (data.size() > 253) {
@@ -67,6 +66,11 @@ Parameter ProtocolV1::synchronizeOnHeader(Timeout timeout, MotorID expectedMotor
 	};
 	std::array<std::byte, 2> syncMarker = {std::byte{0xff}, std::byte{0xff}};
 	auto startTime = std::chrono::high_resolution_clock::now();
+	bool resynchronized {false};
+	auto found = [&]{
+		mReceiveStatistics.resyncs += resynchronized;
+		return preambleBuffer;
+	};
 	while (not ((timeout.count() != 0) and (std::chrono::high_resolution_clock::now() - startTime >= timeout))) {
 		// figure out how many bytes have to be read
 		int indexOfSyncMarker = 0;
@@ -75,9 +79,11 @@ Parameter ProtocolV1::synchronizeOnHeader(Timeout timeout, MotorID expectedMotor
 				break;
 			}
 		}
+		resynchronized |= indexOfSyncMarker > 0;
 		preambleBuffer.erase(preambleBuffer.begin(), preambleBuffer.begin()+indexOfSyncMarker);
 		int bytesToRead = std::max(1, static_cast<int>(sizeof(Header)+1) - static_cast<int>(preambleBuffer.size()));
 		auto buffer = file_io::read(port, bytesToRead);
+		mReceiveStatistics.bytes += buffer.size();
 		preambleBuffer.insert(preambleBuffer.end(), buffer.begin(), buffer.end());
 		if (preambleBuffer.size() >= sizeof(Header)) {
 			// test if this preamble contains the header of the packet we were looking for
@@ -87,16 +93,18 @@ Parameter ProtocolV1::synchronizeOnHeader(Timeout timeout, MotorID expectedMotor
 				// found a synchronization token and a "matching" packet
 				if (expectedMotorID != 0xfe) {
 					if (expectedMotorID == header.id) {
-						return preambleBuffer;
+						return found();
 					}
 					// received an unexpected header -> flush this header and continue reading
 					preambleBuffer.clear();
+					resynchronized = true;
 				} else {
-					return preambleBuffer;
+					return found();
 				}
 			}
 		}
 	}
+	mReceiveStatistics.resyncs += resynchronized;
 	return {};
 }
 
@@ -115,6 +123,7 @@ auto ProtocolV1::readPacket(Timeout timeout, MotorID expectedMotorID, std::size_
 		std::size_t incomingLength = numParameters + 6;
 		while (rxBuf.size() < incomingLength and not timeoutFlag) {
 			auto buffer = file_io::read(port, incomingLength - rxBuf.size());
+			mReceiveStatistics.bytes += buffer.size();
 			rxBuf.insert(rxBuf.end(), buffer.begin(), buffer.end());
 			timeoutFlag = testTimeout();
 		};
@@ -122,12 +131,13 @@ auto ProtocolV1::readPacket(Timeout timeout, MotorID expectedMotorID, std::size_
 			break;
 		}
 		auto  [motorID, errorCode, payload] = extractPayload(rxBuf);
+		mReceiveStatistics.checksumFailures += motorID == MotorIDInvalid;
 		if (payload.size() != numParameters or motorID != expectedMotorID) {
 			continue;
 		}
 		return std::make_tuple(false, motorID, errorCode, payload);
 	}
-	file_io::flushRead(port);
+	mReceiveStatistics.bytes += file_io::flushRead(port);
 	return std::make_tuple(true, MotorIDInvalid, ErrorCode{}, Parameter{});
 }
 
@@ -179,5 +189,8 @@ auto ProtocolV1::buildBulkReadPackage(std::vector<std::tuple<MotorID, int, size_
 	return txBuf;
 }
 
+auto ProtocolV1::buildBulkWritePackage(std::vector<std::tuple<MotorID, int, Parameter>> const&) const -> std::vector<std::byte> {
+	throw std::runtime_error("bulk_write is not supported in protocol v1");
+}
 
 }
@@ -4,6 +4,14 @@
 
 namespace dynamixel {
 
+// packet level helpers, exposed for the simulator and the benchmarks
+namespace detail::v1 {
+// checksum over packet[2..] (the checksum byte itself must not be part of packet)
+[[nodiscard]] auto calculateChecksum(Parameter const& packet) -> std::byte;
+// checks header, length and checksum of a complete packet
+[[nodiscard]] bool validatePacket(Parameter const& rxBuf);
+}
+
 struct ProtocolV1 : public ProtocolBase {
 	[[nodiscard]] auto createPacket(MotorID motorID, Instruction instr, Parameter data) const -> Parameter override;
 	[[nodiscard]] auto readPacket(Timeout timeout, MotorID expectedMotorID, std::size_t numParameters, simplyfile::SerialPort const& port) const -> std::tuple<bool, MotorID, ErrorCode, Parameter> override;
@@ -13,6 +21,7 @@ struct ProtocolV1 : public ProtocolBase {
 	auto convertAddress(int addr)  const -> Parameter override;
 
 	auto buildBulkReadPackage(std::vector<std::tuple<MotorID, int, size_t>> const& motors) const -> std::vector<std::byte> override;
+	auto buildBulkWritePackage(std::vector<std::tuple<MotorID, int, Parameter>> const& motors) const -> std::vector<std::byte> override;
 
 private:
 	Parameter synchronizeOnHeader(Timeout timeout, MotorID expectedMotorID, std::size_t numParameters, simplyfile::SerialPort const& port) const;
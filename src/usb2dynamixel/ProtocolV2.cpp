@@ -7,9 +7,8 @@
 
 namespace dynamixel {
 
-namespace {
+namespace detail::v2 {
 
-[[nodiscard]]
 auto calculateChecksum(Parameter::const_iterator begin, Parameter::const_iterator end) -> Parameter {
 	static const std::array<uint16_t, 256> crc_table = {
 		0x0000, 0x8005, 0x800F, 0x000A, 0x801B, 0x001E, 0x0014, 0x8011,
@@ -55,7 +54,6 @@ auto calculateChecksum(Parameter::const_iterator begin, Parameter::const_iterato
 	return {std::byte(checkSum & 0xff), std::byte((checkSum >> 8) & 0xff)};
 }
 
-[[nodiscard]]
 auto addEscapes(Parameter::const_iterator start, Parameter::const_iterator end) -> Parameter {
 	Parameter escaped;
 	int state{0};
@@ -75,7 +73,6 @@ auto addEscapes(Parameter::const_iterator start, Parameter::const_iterator end)
 	return escaped;
 }
 
-[[nodiscard]]
 auto removeEscapes(Parameter::const_iterator start, Parameter::const_iterator end) -> Parameter {
 	Parameter unescaped;
 	int state{0};
@@ -97,7 +94,6 @@ auto removeEscapes(Parameter::const_iterator start, Parameter::const_iterator en
 	return unescaped;
 }
 
-[[nodiscard]]
 bool validatePacket(Parameter const& rxBuf) {
 	if (rxBuf.size() > ((2<<16)-1)) {
 		return false;
@@ -121,6 +117,7 @@ bool validatePacket(Parameter const& rxBuf) {
 	return success;
 }
 }
+using namespace detail::v2;
 
 auto ProtocolV2::createPacket(MotorID motorID, Instruction instr, Parameter data) const -> Parameter {
 	auto escaped = addEscapes(data.begin(), data.end());
@@ -151,7 +148,11 @@ Parameter ProtocolV2::synchronizeOnHeader(Timeout timeout, MotorID expectedMotor
 	};
 	std::array<std::byte, 4> syncMarker = {std::byte{0xff}, std::byte{0xff}, std::byte{0xfd}, std::byte{0x00}};
 	auto startTime = std::chrono::high_resolution_clock::now();
-
+	bool resynchronized {false};
+	auto found = [&]{
+		mReceiveStatistics.resyncs += resynchronized;
+		return preambleBuffer;
+	};
 	while (not ((timeout.count() != 0) and (std::chrono::high_resolution_clock::now() - startTime >= timeout))) {
 		// figure out how many bytes have to be read
 		int indexOfSyncMarker = 0;
@@ -160,9 +161,11 @@ Parameter ProtocolV2::synchronizeOnHeader(Timeout timeout, MotorID expectedMotor
 				break;
 			}
 		}
+		resynchronized |= indexOfSyncMarker > 0;
 		preambleBuffer.erase(preambleBuffer.begin(), preambleBuffer.begin()+indexOfSyncMarker);
 		int bytesToRead = std::max(1, static_cast<int>(sizeof(Header)+2) - static_cast<int>(preambleBuffer.size()));
 		auto buffer = file_io::read(port, bytesToRead);
+		mReceiveStatistics.bytes += buffer.size();
 		preambleBuffer.insert(preambleBuffer.end(), buffer.begin(), buffer.end());
 		if (preambleBuffer.size() >= sizeof(Header)) {
 			// test if this preamble contains the header of the packet we were looking for
@@ -172,16 +175,18 @@ Parameter ProtocolV2::synchronizeOnHeader(Timeout timeout, MotorID expectedMotor
 				// found a synchronization token and a "matching" packet
 				if (expectedMotorID != 0xfe) {
 					if (expectedMotorID == header.id) {
-						return preambleBuffer;
+						return found();
 					}
 					// received an unexpected header -> flush this header and continue reading
 					preambleBuffer.clear();
+					resynchronized = true;
 				} else {
-					return preambleBuffer;
+					return found();
 				}
 			}
 		}
 	}
+	mReceiveStatistics.resyncs += resynchronized;
 	return {};
 }
 
@@ -199,6 +204,7 @@ auto ProtocolV2::readPacket(Timeout timeout, MotorID expectedMotorID, std::size_
 		std::size_t incomingLength = static_cast<int>(rxBuf[5]) + (static_cast<int>(rxBuf[6]) << 8) + 7;
 		while (rxBuf.size() < incomingLength and not timeoutFlag) { // read the rest
 			auto buffer = file_io::read(port, incomingLength - rxBuf.size());
+			mReceiveStatistics.bytes += buffer.size();
 			rxBuf.insert(rxBuf.end(), buffer.begin(), buffer.end());
 			timeoutFlag = (timeout.count() != 0) and (std::chrono::high_resolution_clock::now() - startTime >= timeout);
 		};
@@ -207,12 +213,13 @@ auto ProtocolV2::readPacket(Timeout timeout, MotorID expectedMotorID, std::size_
 		}
 
 		auto  [motorID, errorCode, payload] = extractPayload(rxBuf);
+		mReceiveStatistics.checksumFailures += motorID == MotorIDInvalid;
 		if (payload.size() != numParameters or motorID != expectedMotorID) {
 			continue;
 		}
 		return std::make_tuple(false, motorID, errorCode, payload);
 	}
-	file_io::flushRead(port);
+	mReceiveStatistics.bytes += file_io::flushRead(port);
 	return std::make_tuple(true, MotorIDInvalid, ErrorCode{}, Parameter{});
 }
 
@@ -256,5 +263,21 @@ auto ProtocolV2::buildBulkReadPackage(std::vector<std::tuple<MotorID, int, size_
 	return txBuf;
 }
 
+auto ProtocolV2::buildBulkWritePackage(std::vector<std::tuple<MotorID, int, Parameter>> const& motors) const -> std::vector<std::byte> {
+	std::vector<std::byte> txBuf;
+
+	for (auto const& [id, baseRegister, params] : motors) {
+		txBuf.push_back(std::byte{id});
+		for (auto b : convertAddress(baseRegister)) {
+			txBuf.push_back(b);
+		}
+		for (auto b : convertLength(params.size())) {
+			txBuf.push_back(b);
+		}
+		txBuf.insert(txBuf.end(), params.begin(), params.end());
+	}
+
+	return txBuf;
+}
 
 }
@@ -4,6 +4,17 @@
 
 namespace dynamixel {
 
+// packet level helpers, exposed for the simulator and the benchmarks
+namespace detail::v2 {
+// CRC-16 (IBM) over [begin, end), returned as two bytes in wire order
+[[nodiscard]] auto calculateChecksum(Parameter::const_iterator begin, Parameter::const_iterator end) -> Parameter;
+// byte stuffing: addEscapes inserts a 0xfd after every 0xff 0xff 0xfd, removeEscapes drops it again
+[[nodiscard]] auto addEscapes(Parameter::const_iterator start, Parameter::const_iterator end) -> Parameter;
+[[nodiscard]] auto removeEscapes(Parameter::const_iterator start, Parameter::const_iterator end) -> Parameter;
+// checks header, length and CRC of a complete packet
+[[nodiscard]] bool validatePacket(Parameter const& rxBuf);
+}
+
 struct ProtocolV2 : public ProtocolBase {
 	[[nodiscard]] auto createPacket(MotorID motorID, Instruction instr, Parameter data) const -> Parameter override;
 	[[nodiscard]] auto readPacket(Timeout timeout, MotorID expectedMotorID, std::size_t numParameters, simplyfile::SerialPort const& port) const -> std::tuple<bool, MotorID, ErrorCode, Parameter> override;
@@ -13,6 +24,7 @@ struct ProtocolV2 : public ProtocolBase {
 	auto convertAddress(int addr)  const -> Parameter override;
 
 	auto buildBulkReadPackage(std::vector<std::tuple<MotorID, int, size_t>> const& motors) const -> std::vector<std::byte> override;
+	auto buildBulkWritePackage(std::vector<std::tuple<MotorID, int, Parameter>> const& motors) const -> std::vector<std::byte> override;
 
 private:
 	Parameter synchronizeOnHeader(Timeout timeout, MotorID expectedMotorID, std::size_t numParameters, simplyfile::SerialPort const& port) const;
@@ -0,0 +1,246 @@
+#include "Remote.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace dynamixel::remote {
+namespace {
+
+struct Encoder {
+	Parameter buf {4}; // space for the length prefix
+
+	void u8(uint8_t v) {
+		buf.push_back(std::byte{v});
+	}
+	void u16(uint16_t v) {
+		u8(v & 0xff);
+		u8(v >> 8);
+	}
+	void u32(uint32_t v) {
+		u16(v & 0xffff);
+		u16(v >> 16);
+	}
+	void bytes(Parameter const& data) {
+		u16(data.size());
+		buf.insert(buf.end(), data.begin(), data.end());
+	}
+	auto finish() -> Parameter {
+		uint32_t size = buf.size() - 4;
+		for (int i{0}; i < 4; ++i) {
+			buf[i] = std::byte((size >> (8*i)) & 0xff);
+		}
+		return std::move(buf);
+	}
+};
+
+struct Decoder {
+	Parameter const& buf;
+	std::size_t pos {0};
+
+	void need(std::size_t n) {
+		if (pos + n > buf.size()) {
+			throw std::runtime_error("truncated message from daemon socket");
+		}
+	}
+	auto u8() -> uint8_t {
+		need(1);
+		return uint8_t(buf[pos++]);
+	}
+	auto u16() -> uint16_t {
+		uint16_t low = u8();
+		return low | (uint16_t(u8()) << 8);
+	}
+	auto u32() -> uint32_t {
+		uint32_t low = u16();
+		return low | (uint32_t(u16()) << 16);
+	}
+	auto bytes() -> Parameter {
+		std::size_t n = u16();
+		need(n);
+		Parameter data(std::next(buf.begin(), pos), std::next(buf.begin(), pos + n));
+		pos += n;
+		return data;
+	}
+};
+
+}
+
+auto socketPath(std::string const& device) -> std::string {
+	auto name = std::filesystem::path{device}.filename().string();
+	return "/tmp/inspexel-" + name + ".sock";
+}
+
+auto encode(Request const& request) -> Parameter {
+	Encoder e;
+	e.u8(uint8_t(request.op));
+	e.u8(request.motor);
+	e.u16(request.baseRegister);
+	e.u16(request.length);
+	e.u32(request.timeout.count());
+	e.bytes(request.data);
+	e.u16(request.reads.size());
+	for (auto const& [motor, baseRegister, length] : request.reads) {
+		e.u8(motor);
+		e.u16(baseRegister);
+		e.u16(length);
+	}
+	e.u16(request.writes.size());
+	for (auto const& [motor, baseRegister, data] : request.writes) {
+		e.u8(motor);
+		e.u16(baseRegister);
+		e.bytes(data);
+	}
+	return e.finish();
+}
+
+auto decodeRequest(Parameter const& message) -> Request {
+	Decoder d{message};
+	Request request;
+	request.op           = Op(d.u8());
+	request.motor        = d.u8();
+	request.baseRegister = d.u16();
+	request.length       = d.u16();
+	request.timeout      = std::chrono::microseconds{d.u32()};
+	request.data         = d.bytes();
+	for (auto n = d.u16(); n > 0; --n) {
+		MotorID motor = d.u8();
+		int baseRegister = d.u16();
+		std::size_t length = d.u16();
+		request.reads.emplace_back(motor, baseRegister, length);
+	}
+	for (auto n = d.u16(); n > 0; --n) {
+		MotorID motor = d.u8();
+		int baseRegister = d.u16();
+		request.writes.emplace_back(motor, baseRegister, d.bytes());
+	}
+	return request;
+}
+
+auto encode(Response const& response) -> Parameter {
+	Encoder e;
+	e.u8(not response.error.empty());
+	if (not response.error.empty()) {
+		Parameter msg(response.error.size());
+		std::memcpy(msg.data(), response.error.data(), msg.size());
+		e.bytes(msg);
+		return e.finish();
+	}
+	e.u8(response.protocol);
+	e.u32(response.baudrate);
+	e.u8(response.timeout);
+	e.u8(response.motor);
+	e.u8(uint8_t(response.errorCode));
+	e.bytes(response.data);
+	e.u16(response.reads.size());
+	for (auto const& [motor, baseRegister, errorCode, data] : response.reads) {
+		e.u8(motor);
+		e.u16(baseRegister);
+		e.u8(uint8_t(errorCode));
+		e.bytes(data);
+	}
+	return e.finish();
+}
+
+auto decodeResponse(Parameter const& message) -> Response {
+	Decoder d{message};
+	Response response;
+	if (d.u8()) {
+		auto msg = d.bytes();
+		response.error.assign(reinterpret_cast<char const*>(msg.data()), msg.size());
+		return response;
+	}
+	response.protocol  = d.u8();
+	response.baudrate  = d.u32();
+	response.timeout   = d.u8();
+	response.motor     = d.u8();
+	response.errorCode = ErrorCode(d.u8());
+	response.data      = d.bytes();
+	for (auto n = d.u16(); n > 0; --n) {
+		MotorID motor = d.u8();
+		int baseRegister = d.u16();
+		auto errorCode = ErrorCode(d.u8());
+		response.reads.emplace_back(motor, baseRegister, errorCode, d.bytes());
+	}
+	return response;
+}
+
+auto extractMessages(Parameter& buffer) -> std::vector<Parameter> {
+	std::vector<Parameter> messages;
+	std::size_t pos {0};
+	while (buffer.size() - pos >= 4) {
+		uint32_t size {0};
+		for (int i{0}; i < 4; ++i) {
+			size |= uint32_t(buffer[pos + i]) << (8*i);
+		}
+		if (buffer.size() - pos - 4 < size) {
+			break;
+		}
+		auto first = std::next(buffer.begin(), pos + 4);
+		messages.emplace_back(first, std::next(first, size));
+		pos += 4 + size;
+	}
+	buffer.erase(buffer.begin(), std::next(buffer.begin(), pos));
+	return messages;
+}
+
+Client::Client(simplyfile::ClientSocket socket)
+	: mSocket(std::move(socket))
+{}
+
+auto Client::connect(std::string const& path) -> std::unique_ptr<Client> {
+	if (not std::filesystem::exists(path)) {
+		return nullptr;
+	}
+	simplyfile::ClientSocket socket{simplyfile::makeUnixDomainHost(path)};
+	try {
+		socket.connect();
+	} catch (std::exception const&) {
+		// a stale socket file of a daemon that is gone
+		return nullptr;
+	}
+	return std::unique_ptr<Client>(new Client(std::move(socket)));
+}
+
+auto Client::transact(Request const& request) const -> Response {
+	auto g = std::lock_guard(mMutex);
+	auto txBuf = encode(request);
+	std::size_t sent {0};
+	while (sent < txBuf.size()) {
+		auto n = ::send(mSocket, txBuf.data() + sent, txBuf.size() - sent, MSG_NOSIGNAL);
+		if (n < 0 and errno == EINTR) {
+			continue;
+		}
+		if (n <= 0) {
+			throw std::runtime_error("lost connection to inspexel daemon: " + std::string(strerror(errno)));
+		}
+		sent += n;
+	}
+
+	while (true) {
+		auto messages = extractMessages(mBuffer);
+		if (not messages.empty()) {
+			auto response = decodeResponse(messages.front());
+			if (not response.error.empty()) {
+				throw std::runtime_error("inspexel daemon: " + response.error);
+			}
+			return response;
+		}
+		std::byte chunk[4096];
+		auto n = ::read(mSocket, chunk, sizeof(chunk));
+		if (n < 0 and errno == EINTR) {
+			continue;
+		}
+		if (n <= 0) {
+			throw std::runtime_error("lost connection to inspexel daemon");
+		}
+		mBuffer.insert(mBuffer.end(), chunk, chunk + n);
+	}
+}
+
+}
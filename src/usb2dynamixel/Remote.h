@@ -0,0 +1,88 @@
+#pragma once
+
+#include "dynamixel.h"
+#include "ProtocolBase.h"
+
+#include <simplyfile/socket/Socket.h>
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <vector>
+
+/**
+ * access to a bus that is owned by an "inspexel serve" daemon
+ *
+ * the daemon listens on a unix socket, every message (in both directions) is prefixed by its length
+ * (uint32_t, little endian, not counting the length field itself). A client sends one request and waits for its response.
+ */
+namespace dynamixel::remote {
+
+// the socket a daemon for device listens on
+[[nodiscard]] auto socketPath(std::string const& device) -> std::string;
+
+enum class Op : uint8_t {
+	Hello,     // returns the protocol version and baudrate the daemon talks to the motors with
+	Ping,
+	Read,
+	BulkRead,
+	Write,
+	WriteRead,
+	SyncWrite,
+	BulkWrite,
+	RegWrite,
+	Action,
+	Reset,
+	Reboot,
+	SynchronizedWrite, // writes, executed without other requests in between
+};
+
+struct Request {
+	Op                        op           {Op::Hello};
+	MotorID                   motor        {BroadcastID};
+	int                       baseRegister {0};
+	std::size_t               length       {0};
+	std::chrono::microseconds timeout      {0};
+	Parameter                 data;
+	std::vector<std::tuple<MotorID, int, std::size_t>> reads;  // BulkRead
+	std::vector<std::tuple<MotorID, int, Parameter>>   writes; // SyncWrite, BulkWrite, SynchronizedWrite
+};
+
+struct Response {
+	std::string error;                // not empty if the daemon could not execute the request
+	uint8_t     protocol  {0};        // Hello
+	uint32_t    baudrate  {0};        // Hello
+	bool        timeout   {false};
+	MotorID     motor     {MotorIDInvalid};
+	ErrorCode   errorCode {};
+	Parameter   data;
+	std::vector<std::tuple<MotorID, int, ErrorCode, Parameter>> reads; // BulkRead
+};
+
+// encoded messages include the length prefix, decoding expects the message without it
+[[nodiscard]] auto encode(Request const& request) -> Parameter;
+[[nodiscard]] auto encode(Response const& response) -> Parameter;
+[[nodiscard]] auto decodeRequest(Parameter const& message) -> Request;
+[[nodiscard]] auto decodeResponse(Parameter const& message) -> Response;
+
+// removes all complete messages from the front of buffer and returns them (without length prefix)
+[[nodiscard]] auto extractMessages(Parameter& buffer) -> std::vector<Parameter>;
+
+struct Client {
+	// returns nullptr if no daemon is listening on path
+	[[nodiscard]] static auto connect(std::string const& path) -> std::unique_ptr<Client>;
+
+	// throws if the connection is lost or the daemon reports an error
+	auto transact(Request const& request) const -> Response;
+
+private:
+	explicit Client(simplyfile::ClientSocket socket);
+
+	simplyfile::ClientSocket mSocket;
+	mutable std::mutex       mMutex;
+	mutable Parameter        mBuffer;
+};
+
+}
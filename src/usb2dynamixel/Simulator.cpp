@@ -0,0 +1,477 @@
+#include "Simulator.h"
+#include "MotorMetaInfo.h"
+#include "ProtocolV1.h"
+#include "ProtocolV2.h"
+#include "file_io.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <termios.h>
+
+namespace dynamixel {
+
+struct Simulator::Motor {
+	MotorID                                  id;
+	uint16_t                                 modelNumber;
+	std::optional<std::chrono::microseconds> returnDelay;
+
+	Parameter         registers;
+	Parameter         defaults;
+	std::vector<bool> romArea;
+	int               idRegister                {0};
+	int               returnDelayRegister       {0};
+	int               statusReturnLevelRegister {0};
+	int               firmwareRegister          {0};
+	std::optional<std::tuple<int, int>> goalPosition;    // register, width
+	std::optional<std::tuple<int, int>> presentPosition;
+	std::optional<std::tuple<int, Parameter>> registeredWrite;
+
+	[[nodiscard]] bool inRange(int baseRegister, std::size_t length) const {
+		return baseRegister >= 0 and baseRegister + length <= registers.size();
+	}
+
+	void write(int baseRegister, Parameter const& data) {
+		std::copy(data.begin(), data.end(), std::next(registers.begin(), baseRegister));
+		id = MotorID(registers[idRegister]);
+		if (goalPosition and presentPosition) {
+			auto [goal, goalWidth]       = *goalPosition;
+			auto [present, presentWidth] = *presentPosition;
+			if (baseRegister < goal + goalWidth and baseRegister + int(data.size()) > goal) {
+				std::copy_n(std::next(registers.begin(), goal), std::min(goalWidth, presentWidth), std::next(registers.begin(), present));
+			}
+		}
+	}
+
+	[[nodiscard]] auto read(int baseRegister, std::size_t length) const -> Parameter {
+		return Parameter(std::next(registers.begin(), baseRegister), std::next(registers.begin(), baseRegister + length));
+	}
+
+	[[nodiscard]] auto statusReturnLevel() const -> StatusReturnLevel {
+		return StatusReturnLevel(registers[statusReturnLevelRegister]);
+	}
+
+	[[nodiscard]] auto getReturnDelay() const -> std::chrono::microseconds {
+		// RETURN_DELAY_TIME counts in units of 2us
+		return returnDelay.value_or(std::chrono::microseconds{2 * int(registers[returnDelayRegister])});
+	}
+
+	void reboot() {
+		for (std::size_t i{0}; i < registers.size(); ++i) {
+			if (not romArea[i]) {
+				registers[i] = defaults[i];
+			}
+		}
+	}
+
+	void reset() {
+		auto keepID = registers[idRegister];
+		registers   = defaults;
+		registers[idRegister] = keepID;
+	}
+
+	// nullopt if there is no register table for the model
+	static auto make(SimulatedMotor const& spec) -> std::optional<Motor>;
+};
+
+auto Simulator::Motor::make(SimulatedMotor const& spec) -> std::optional<Motor> {
+	std::optional<Motor> motor;
+	meta::forAllLayoutTypes([&](auto const& info) {
+		using Info     = std::decay_t<decltype(info)>;
+		using Register = typename Info::FullLayout::Type;
+		auto const& defaults = Info::getDefaults();
+		auto iter = defaults.find(spec.modelNumber);
+		if (iter == defaults.end()) {
+			return;
+		}
+		auto const& infos = Info::getInfos();
+		auto size = Info::FullLayout::Length;
+
+		motor.emplace();
+		motor->id          = spec.id;
+		motor->modelNumber = spec.modelNumber;
+		motor->returnDelay = spec.returnDelay;
+		motor->defaults.resize(size);
+		motor->romArea.resize(size, false);
+		for (auto const& [reg, field] : infos) {
+			for (std::size_t i{0}; i < field.length and int(reg) + i < size; ++i) {
+				motor->romArea[int(reg) + i] = field.romArea;
+			}
+			if (field.name == "Goal Position") {
+				motor->goalPosition = std::make_tuple(int(reg), int(field.length));
+			} else if (field.name == "Present Position") {
+				motor->presentPosition = std::make_tuple(int(reg), int(field.length));
+			} else if (field.name == "Version of Firmware" or field.name == "Firmware Version") {
+				motor->firmwareRegister = int(reg);
+			}
+		}
+		for (auto const& [reg, value] : iter->second.defaultLayout) {
+			auto const& defaultValue = std::get<0>(value);
+			auto field = infos.find(reg);
+			if (not defaultValue or field == infos.end()) {
+				continue;
+			}
+			for (std::size_t i{0}; i < field->second.length and int(reg) + i < size; ++i) {
+				motor->defaults[int(reg) + i] = std::byte((*defaultValue >> (8*i)) & 0xff);
+			}
+		}
+		motor->idRegister                = int(Register::ID);
+		motor->returnDelayRegister       = int(Register::RETURN_DELAY_TIME);
+		motor->statusReturnLevelRegister = int(Register::STATUS_RETURN_LEVEL);
+		motor->registers = motor->defaults;
+		motor->registers[motor->idRegister] = std::byte{spec.id};
+	});
+	return motor;
+}
+
+namespace {
+
+// little endian value of width bytes at offset, nullopt if the packet is too short
+auto getValue(Parameter const& parameters, std::size_t offset, std::size_t width) -> std::optional<int> {
+	if (offset + width > parameters.size()) {
+		return std::nullopt;
+	}
+	int value {0};
+	for (std::size_t i{0}; i < width; ++i) {
+		value |= int(parameters[offset + i]) << (8*i);
+	}
+	return value;
+}
+
+}
+
+Simulator::Simulator(std::vector<SimulatedMotor> const& motors, Options const& options)
+	: mOptions {options}
+	, mRandom  {options.seed}
+{
+	for (auto const& spec : motors) {
+		auto motor = Motor::make(spec);
+		if (not motor) {
+			throw std::runtime_error("no register table for model " + std::to_string(spec.modelNumber));
+		}
+		if (std::any_of(mMotors.begin(), mMotors.end(), [&](auto const& m) { return m.id == spec.id; })) {
+			throw std::runtime_error("motor " + std::to_string(spec.id) + " is simulated twice");
+		}
+		mMotors.push_back(std::move(*motor));
+	}
+	std::sort(mMotors.begin(), mMotors.end(), [](auto const& l, auto const& r) { return l.id < r.id; });
+
+	if (mOptions.baudrate > 0) {
+		// 8N1: 10 bits per byte
+		mByteTime = std::chrono::nanoseconds{std::chrono::seconds{10}} / mOptions.baudrate;
+	}
+
+	mMaster = ::posix_openpt(O_RDWR | O_NOCTTY);
+	if (not mMaster.valid() or 0 != ::grantpt(mMaster) or 0 != ::unlockpt(mMaster)) {
+		throw std::runtime_error("cannot create a pseudo terminal: " + std::string(strerror(errno)));
+	}
+	std::array<char, 128> name;
+	if (0 != ::ptsname_r(mMaster, name.data(), name.size())) {
+		throw std::runtime_error("ptsname " + std::string(strerror(errno)));
+	}
+	mDevice = name.data();
+	mSlave  = ::open(mDevice.c_str(), O_RDWR | O_NOCTTY);
+	if (not mSlave.valid()) {
+		throw std::runtime_error("cannot open " + mDevice + ": " + strerror(errno));
+	}
+	// the line settings belong to the pty, clients find it in raw mode even before they configure it
+	struct termios attributes;
+	if (0 == ::tcgetattr(mSlave, &attributes)) {
+		::cfmakeraw(&attributes);
+		::tcsetattr(mSlave, TCSANOW, &attributes);
+	}
+}
+
+Simulator::~Simulator() {
+}
+
+auto Simulator::getStats() const -> Stats {
+	return Stats{mInstructions, mCorrupted, mStatusPackets, mLost, mNoisyBytes};
+}
+
+void Simulator::run(std::atomic<bool> const& stop) {
+	Parameter buffer;
+	std::array<std::byte, 4096> chunk;
+	auto firstByte = std::chrono::steady_clock::now();
+	while (not stop) {
+		pollfd pfd {mMaster, POLLIN, 0};
+		if (::poll(&pfd, 1, 100) <= 0 or not (pfd.revents & POLLIN)) {
+			continue;
+		}
+		auto r = ::read(mMaster, chunk.data(), chunk.size());
+		if (r <= 0) {
+			continue;
+		}
+		if (buffer.empty()) {
+			firstByte = std::chrono::steady_clock::now();
+		}
+		buffer.insert(buffer.end(), chunk.begin(), std::next(chunk.begin(), r));
+
+		while (auto request = extractRequest(buffer)) {
+			// the instruction is complete once its last byte went over the wire
+			std::this_thread::sleep_until(firstByte + mByteTime * request->wireSize);
+			++mInstructions;
+			handle(*request);
+			firstByte = std::chrono::steady_clock::now();
+		}
+	}
+}
+
+auto Simulator::extractRequest(Parameter& buffer) -> std::optional<Request> {
+	bool v2 = mOptions.protocol == Protocol::V2;
+	auto header = v2 ? Parameter{std::byte{0xff}, std::byte{0xff}, std::byte{0xfd}, std::byte{0x00}}
+	                 : Parameter{std::byte{0xff}, std::byte{0xff}};
+	while (true) {
+		buffer.erase(buffer.begin(), std::search(buffer.begin(), buffer.end(), header.begin(), header.end()));
+		std::size_t headerSize = v2 ? 7 : 4;
+		if (buffer.size() < headerSize) {
+			return std::nullopt;
+		}
+		std::size_t length = v2 ? (std::size_t(buffer[5]) | (std::size_t(buffer[6]) << 8)) : std::size_t(buffer[3]);
+		std::size_t size   = headerSize + length;
+		if (length < (v2 ? 3 : 2) or (not v2 and buffer[2] == std::byte{0xff})) {
+			// cannot be an instruction packet, resynchronize behind this header
+			++mCorrupted;
+			buffer.erase(buffer.begin());
+			continue;
+		}
+		if (buffer.size() < size) {
+			return std::nullopt;
+		}
+		auto packet = Parameter(buffer.begin(), std::next(buffer.begin(), size));
+		if (not (v2 ? detail::v2::validatePacket(packet) : detail::v1::validatePacket(packet))) {
+			++mCorrupted;
+			buffer.erase(buffer.begin());
+			continue;
+		}
+		buffer.erase(buffer.begin(), std::next(buffer.begin(), size));
+		if (v2) {
+			return Request{MotorID(packet[4]), Instruction(packet[7]), detail::v2::removeEscapes(std::next(packet.begin(), 8), std::prev(packet.end(), 2)), size};
+		}
+		return Request{MotorID(packet[2]), Instruction(packet[4]), Parameter(std::next(packet.begin(), 5), std::prev(packet.end())), size};
+	}
+}
+
+auto Simulator::findMotor(MotorID id) -> Motor* {
+	auto iter = std::find_if(mMotors.begin(), mMotors.end(), [&](auto const& m) { return m.id == id; });
+	return iter == mMotors.end() ? nullptr : &*iter;
+}
+
+bool Simulator::receives(Motor const&) {
+	if (mOptions.loss > 0. and std::uniform_real_distribution<double>{}(mRandom) < mOptions.loss) {
+		++mLost;
+		return false;
+	}
+	return true;
+}
+
+void Simulator::handle(Request const& request) {
+	bool v2 = mOptions.protocol == Protocol::V2;
+	std::size_t addressWidth = v2 ? 2 : 1;
+	uint8_t rangeError       = v2 ? 0x07 : uint8_t(ErrorCode::Range);       // protocol 2: access error
+	uint8_t instructionError = v2 ? 0x02 : uint8_t(ErrorCode::Instruction);
+	auto const& params = request.parameters;
+	bool broadcast = request.id == BroadcastID;
+
+	// the motors an instruction is addressed to (and that did not miss it)
+	std::vector<Motor*> addressed;
+	for (auto& motor : mMotors) {
+		if ((broadcast or motor.id == request.id) and receives(motor)) {
+			addressed.push_back(&motor);
+		}
+	}
+	auto answersWrites = [&](Motor const& motor) {
+		return not broadcast and motor.statusReturnLevel() == StatusReturnLevel::All;
+	};
+	// the motors answer read requests of several motors one after another in the requested order
+	auto answerRead = [&](MotorID id, std::optional<int> baseRegister, std::optional<int> length) {
+		auto motor = findMotor(id);
+		if (not motor or not baseRegister or not length or not receives(*motor)) {
+			return;
+		}
+		if (not motor->inRange(*baseRegister, *length)) {
+			respond(*motor, rangeError, {});
+		} else {
+			respond(*motor, 0, motor->read(*baseRegister, *length));
+		}
+	};
+
+	switch (request.instruction) {
+	case Instruction::PING:
+		// protocol 1 motors do not answer a broadcast ping
+		for (auto motor : addressed) {
+			if (broadcast and not v2) {
+				break;
+			}
+			if (v2) {
+				respond(*motor, 0, {std::byte(motor->modelNumber & 0xff), std::byte(motor->modelNumber >> 8), motor->registers[motor->firmwareRegister]});
+			} else {
+				respond(*motor, 0, {});
+			}
+		}
+		break;
+	case Instruction::READ: {
+		auto baseRegister = getValue(params, 0, addressWidth);
+		auto length       = getValue(params, addressWidth, addressWidth);
+		for (auto motor : addressed) {
+			if (broadcast or motor->statusReturnLevel() == StatusReturnLevel::PingOnly) {
+				continue;
+			}
+			if (not baseRegister or not length or not motor->inRange(*baseRegister, *length)) {
+				respond(*motor, rangeError, {});
+			} else {
+				respond(*motor, 0, motor->read(*baseRegister, *length));
+			}
+		}
+		break;
+	}
+	case Instruction::WRITE:
+	case Instruction::REG_WRITE: {
+		auto baseRegister = getValue(params, 0, addressWidth);
+		auto data         = Parameter(std::next(params.begin(), std::min(addressWidth, params.size())), params.end());
+		for (auto motor : addressed) {
+			bool valid = baseRegister and motor->inRange(*baseRegister, data.size());
+			if (valid and request.instruction == Instruction::WRITE) {
+				motor->write(*baseRegister, data);
+			} else if (valid) {
+				motor->registeredWrite = std::make_tuple(*baseRegister, data);
+			}
+			if (answersWrites(*motor)) {
+				respond(*motor, valid ? 0 : rangeError, {});
+			}
+		}
+		break;
+	}
+	case Instruction::ACTION:
+		for (auto motor : addressed) {
+			if (motor->registeredWrite) {
+				auto const& [baseRegister, data] = *motor->registeredWrite;
+				motor->write(baseRegister, data);
+				motor->registeredWrite.reset();
+			}
+			if (answersWrites(*motor)) {
+				respond(*motor, 0, {});
+			}
+		}
+		break;
+	case Instruction::RESET:
+	case Instruction::REBOOT:
+		for (auto motor : addressed) {
+			if (answersWrites(*motor)) {
+				respond(*motor, 0, {});
+			}
+			if (request.instruction == Instruction::RESET) {
+				motor->reset();
+			} else {
+				motor->reboot();
+			}
+		}
+		break;
+	case Instruction::SYNC_WRITE: {
+		auto baseRegister = getValue(params, 0, addressWidth);
+		auto length       = getValue(params, addressWidth, addressWidth);
+		if (not broadcast or not baseRegister or not length) {
+			break;
+		}
+		for (auto offset = 2*addressWidth; offset + 1 + *length <= params.size(); offset += 1 + *length) {
+			auto motor = findMotor(MotorID(params[offset]));
+			auto data  = Parameter(std::next(params.begin(), offset + 1), std::next(params.begin(), offset + 1 + *length));
+			if (motor and motor->inRange(*baseRegister, data.size()) and receives(*motor)) {
+				motor->write(*baseRegister, data);
+			}
+		}
+		break;
+	}
+	case Instruction::BULK_WRITE:
+		for (std::size_t offset{0}; v2 and broadcast and offset + 5 <= params.size();) {
+			auto motor        = findMotor(MotorID(params[offset]));
+			auto baseRegister = *getValue(params, offset + 1, 2);
+			auto length       = std::size_t(*getValue(params, offset + 3, 2));
+			if (offset + 5 + length > params.size()) {
+				break;
+			}
+			auto data = Parameter(std::next(params.begin(), offset + 5), std::next(params.begin(), offset + 5 + length));
+			if (motor and motor->inRange(baseRegister, length) and receives(*motor)) {
+				motor->write(baseRegister, data);
+			}
+			offset += 5 + length;
+		}
+		break;
+	case Instruction::SYNC_READ: {
+		auto baseRegister = getValue(params, 0, 2);
+		auto length       = getValue(params, 2, 2);
+		for (std::size_t offset{4}; v2 and broadcast and offset < params.size(); ++offset) {
+			answerRead(MotorID(params[offset]), baseRegister, length);
+		}
+		break;
+	}
+	case Instruction::BULK_READ:
+		if (not broadcast) {
+			break;
+		}
+		if (v2) {
+			// <id> <address> <length> with 2 byte address and length
+			for (std::size_t offset{0}; offset + 5 <= params.size(); offset += 5) {
+				answerRead(MotorID(params[offset]), getValue(params, offset + 1, 2), getValue(params, offset + 3, 2));
+			}
+		} else {
+			// 0x00 followed by <length> <id> <address>
+			for (std::size_t offset{1}; offset + 3 <= params.size(); offset += 3) {
+				answerRead(MotorID(params[offset + 1]), getValue(params, offset + 2, 1), getValue(params, offset, 1));
+			}
+		}
+		break;
+	default:
+		for (auto motor : addressed) {
+			if (not broadcast) {
+				respond(*motor, instructionError, {});
+			}
+		}
+		break;
+	}
+}
+
+void Simulator::respond(Motor const& motor, uint8_t error, Parameter const& data) {
+	std::this_thread::sleep_for(motor.getReturnDelay());
+	Parameter packet;
+	if (mOptions.protocol == Protocol::V2) {
+		Parameter payload {std::byte{error}};
+		payload.insert(payload.end(), data.begin(), data.end());
+		packet = ProtocolV2{}.createPacket(motor.id, Instruction::STATUS, payload);
+	} else {
+		packet = ProtocolV1{}.createPacket(motor.id, Instruction(error), data);
+	}
+	if (mOptions.noise > 0.) {
+		for (auto& b : packet) {
+			if (std::uniform_real_distribution<double>{}(mRandom) < mOptions.noise) {
+				b ^= std::byte(1 << std::uniform_int_distribution<int>{0, 7}(mRandom));
+				++mNoisyBytes;
+			}
+		}
+	}
+	++mStatusPackets;
+	transmit(std::move(packet));
+}
+
+void Simulator::transmit(Parameter packet) {
+	if (mByteTime.count() == 0) {
+		file_io::write(mMaster, packet);
+		return;
+	}
+	// hand out every byte once it would have been received completely, the sleeps batch a few bytes at high baudrates
+	auto start = std::chrono::steady_clock::now();
+	for (std::size_t sent{0}; sent < packet.size();) {
+		std::this_thread::sleep_until(start + mByteTime * (sent + 1));
+		auto due = std::size_t((std::chrono::steady_clock::now() - start) / mByteTime);
+		due = std::clamp(due, sent + 1, packet.size());
+		file_io::write(mMaster, Parameter(std::next(packet.begin(), sent), std::next(packet.begin(), due)));
+		sent = due;
+	}
+}
+
+}
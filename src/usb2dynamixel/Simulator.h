@@ -0,0 +1,90 @@
+#pragma once
+
+#include "USB2Dynamixel.h"
+
+#include <simplyfile/FileDescriptor.h>
+
+#include <atomic>
+#include <chrono>
+#include <optional>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace dynamixel {
+
+struct SimulatedMotor {
+	MotorID  id;
+	uint16_t modelNumber;
+	// delay between an instruction and the status packet (default: the motor's RETURN_DELAY_TIME register)
+	std::optional<std::chrono::microseconds> returnDelay;
+};
+
+/**
+ * emulates motors behind a pseudo terminal, USB2Dynamixel can use the slave side (getDevice()) like a serial port
+ *
+ * the register tables are initialized from the default tables of the motor models and behave like a real motor's:
+ * the ID, RETURN_DELAY_TIME and STATUS_RETURN_LEVEL registers are honored, REBOOT restores the RAM area, RESET all registers but the id
+ * goal positions are reached instantly (the present position follows every write of the goal position)
+ */
+struct Simulator {
+	struct Options {
+		Protocol protocol {Protocol::V1};
+		int      baudrate {0};  // send every byte not earlier than a bus with this baudrate would (0: no pacing)
+		double   loss     {0.}; // probability that a motor misses an instruction packet
+		double   noise    {0.}; // probability that a byte of a status packet gets a bit flipped
+		uint32_t seed     {0};
+	};
+
+	struct Stats {
+		uint64_t instructions  {0}; // valid instruction packets received
+		uint64_t corrupted     {0}; // packets dropped because of a wrong length or checksum
+		uint64_t statusPackets {0};
+		uint64_t lost          {0}; // instruction packets a motor ignored because of Options::loss
+		uint64_t noisyBytes    {0};
+	};
+
+	Simulator(std::vector<SimulatedMotor> const& motors, Options const& options);
+	~Simulator();
+
+	// path of the pty slave
+	[[nodiscard]] auto getDevice() const -> std::string const& { return mDevice; }
+
+	// answer instruction packets until stop becomes true
+	void run(std::atomic<bool> const& stop);
+
+	[[nodiscard]] auto getStats() const -> Stats;
+
+private:
+	struct Motor;
+	struct Request {
+		MotorID     id;
+		Instruction instruction;
+		Parameter   parameters;
+		std::size_t wireSize;
+	};
+
+	[[nodiscard]] auto extractRequest(Parameter& buffer) -> std::optional<Request>;
+	void handle(Request const& request);
+	[[nodiscard]] auto findMotor(MotorID id) -> Motor*;
+	// false if the motor misses this packet
+	[[nodiscard]] bool receives(Motor const& motor);
+	void respond(Motor const& motor, uint8_t error, Parameter const& data);
+	void transmit(Parameter packet);
+
+	Options                   mOptions;
+	std::vector<Motor>        mMotors;
+	std::chrono::nanoseconds  mByteTime {0};
+	simplyfile::FileDescriptor mMaster;
+	simplyfile::FileDescriptor mSlave; // kept open so the master does not see a hangup between two clients
+	std::string               mDevice;
+	std::mt19937              mRandom;
+
+	std::atomic<uint64_t> mInstructions  {0};
+	std::atomic<uint64_t> mCorrupted     {0};
+	std::atomic<uint64_t> mStatusPackets {0};
+	std::atomic<uint64_t> mLost          {0};
+	std::atomic<uint64_t> mNoisyBytes    {0};
+};
+
+}
@@ -0,0 +1,87 @@
+#include "TelemetryFrame.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+namespace dynamixel {
+namespace {
+
+// strided gather of one register out of all raw windows
+// the loop body is branch free so the compiler can vectorize it
+template <typename T>
+void unpackColumn(std::byte const* raw, std::size_t stride, std::size_t motorCount, int32_t* out) {
+	for (std::size_t i{0}; i < motorCount; ++i) {
+		T value;
+		std::memcpy(&value, raw + i * stride, sizeof(T));
+		out[i] = int32_t(value);
+	}
+}
+
+}
+
+TelemetryFrame::TelemetryFrame(std::vector<ColumnDescription> const& _columns) {
+	if (_columns.empty()) {
+		throw std::runtime_error("a telemetry frame needs at least one column");
+	}
+	int windowEnd = std::numeric_limits<int>::min();
+	mWindowBase   = std::numeric_limits<int>::max();
+	for (auto const& description : _columns) {
+		if (description.width != 1 and description.width != 2 and description.width != 4) {
+			throw std::runtime_error("register " + std::to_string(description.baseRegister) + " has unsupported width " + std::to_string(description.width));
+		}
+		mWindowBase = std::min(mWindowBase, description.baseRegister);
+		windowEnd   = std::max(windowEnd, description.baseRegister + description.width);
+		columns.push_back(Column{description, {}});
+	}
+	mWindowLength = windowEnd - mWindowBase;
+}
+
+void TelemetryFrame::resize(std::size_t motorCount) {
+	motors.resize(motorCount);
+	errorCodes.resize(motorCount);
+	mRaw.resize(motorCount * mWindowLength);
+	for (auto& c : columns) {
+		c.values.resize(motorCount);
+	}
+}
+
+auto TelemetryFrame::rawWindow(std::size_t motorIdx) -> std::byte* {
+	return mRaw.data() + motorIdx * mWindowLength;
+}
+
+void TelemetryFrame::unpack(std::size_t motorCount) {
+	if (motorCount * mWindowLength > mRaw.size()) {
+		throw std::runtime_error("telemetry frame holds less than " + std::to_string(motorCount) + " motors");
+	}
+	resize(motorCount);
+	for (auto& c : columns) {
+		auto const& d = c.description;
+		std::byte const* src = mRaw.data() + (d.baseRegister - mWindowBase);
+		switch (d.width) {
+			case 1: d.isSigned ? unpackColumn<int8_t> (src, mWindowLength, motorCount, c.values.data()) : unpackColumn<uint8_t> (src, mWindowLength, motorCount, c.values.data()); break;
+			case 2: d.isSigned ? unpackColumn<int16_t>(src, mWindowLength, motorCount, c.values.data()) : unpackColumn<uint16_t>(src, mWindowLength, motorCount, c.values.data()); break;
+			case 4: d.isSigned ? unpackColumn<int32_t>(src, mWindowLength, motorCount, c.values.data()) : unpackColumn<uint32_t>(src, mWindowLength, motorCount, c.values.data()); break;
+		}
+	}
+}
+
+auto TelemetryFrame::column(int baseRegister) -> std::vector<int32_t>& {
+	auto iter = std::find_if(begin(columns), end(columns), [&](auto const& c) { return c.description.baseRegister == baseRegister; });
+	if (iter == end(columns)) {
+		throw std::runtime_error("register " + std::to_string(baseRegister) + " is not part of this telemetry frame");
+	}
+	return iter->values;
+}
+
+auto TelemetryFrame::column(int baseRegister) const -> std::vector<int32_t> const& {
+	return const_cast<TelemetryFrame&>(*this).column(baseRegister);
+}
+
+void TelemetryFrame::fromMotor(int baseRegister, meta::AffineConvert const& convert, std::vector<double>& out) const {
+	convert.fromMotor(column(baseRegister), out);
+}
+
+}
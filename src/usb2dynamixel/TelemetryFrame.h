@@ -0,0 +1,97 @@
+#pragma once
+
+#include "dynamixel.h"
+#include "ProtocolBase.h"
+#include "LayoutPart.h"
+
+#include <optional>
+#include <type_traits>
+#include <vector>
+
+namespace dynamixel {
+
+/**
+ * a structure-of-arrays snapshot of some registers of many motors
+ *
+ * every requested register is stored as its own contiguous column with one entry per motor.
+ * All values are widened to int32_t on decoding so every column has the same element type
+ * and can be processed in tight (auto-vectorizable) loops.
+ *
+ * A frame is meant to be reused: the raw receive buffer and all columns keep their capacity.
+ */
+struct TelemetryFrame {
+	struct ColumnDescription {
+		int     baseRegister;
+		uint8_t width;      // 1, 2 or 4 bytes
+		bool    isSigned;
+	};
+
+	struct Column {
+		ColumnDescription    description;
+		std::vector<int32_t> values;
+	};
+
+	TelemetryFrame() = default;
+	explicit TelemetryFrame(std::vector<ColumnDescription> const& columns);
+
+	// build a frame from registers that have a LayoutPart definition (e.g. mx_v2::Register::PRESENT_POSITION)
+	template <auto... registers>
+	[[nodiscard]] static auto build() -> TelemetryFrame {
+		return TelemetryFrame{{describe<registers>()...}};
+	}
+
+	template <auto reg>
+	[[nodiscard]] static auto describe() -> ColumnDescription {
+		using PartType = typename LayoutPart<reg>::PartType;
+		static_assert(std::is_arithmetic_v<PartType>, "only scalar registers can be represented in a telemetry frame");
+		return {int(reg), uint8_t(sizeof(PartType)), std::is_signed_v<PartType>};
+	}
+
+	// the smallest register window covering all columns
+	[[nodiscard]] int windowBase() const { return mWindowBase; }
+	[[nodiscard]] std::size_t windowLength() const { return mWindowLength; }
+
+	// size all columns and the receive buffer for motorCount motors
+	void resize(std::size_t motorCount);
+
+	// raw register windows of all motors, motor i occupies bytes [i*windowLength(), (i+1)*windowLength())
+	[[nodiscard]] auto rawWindow(std::size_t motorIdx) -> std::byte*;
+
+	// decode the first motorCount raw windows into the columns
+	void unpack(std::size_t motorCount);
+
+	[[nodiscard]] auto column(int baseRegister) -> std::vector<int32_t>&;
+	[[nodiscard]] auto column(int baseRegister) const -> std::vector<int32_t> const&;
+
+	// convert a whole column to SI units
+	void fromMotor(int baseRegister, meta::AffineConvert const& convert, std::vector<double>& out) const;
+
+	std::vector<MotorID>   motors;
+	std::vector<ErrorCode> errorCodes;
+	std::vector<Column>    columns;
+
+private:
+	int                    mWindowBase   {0};
+	std::size_t            mWindowLength {0};
+	std::vector<std::byte> mRaw;
+};
+
+/**
+ * look up the description of a register within a layout (e.g. mx_v2::FullLayout)
+ * returns an empty optional if the register is not part of the layout or is not scalar
+ */
+template <typename FullLayout>
+auto describeRegister(int reg) -> std::optional<TelemetryFrame::ColumnDescription> {
+	std::optional<TelemetryFrame::ColumnDescription> description;
+	visit([&](auto _reg, auto const& value) {
+		using PartType = std::decay_t<decltype(value)>;
+		if constexpr (std::is_arithmetic_v<PartType>) {
+			if (int(_reg) == reg) {
+				description = TelemetryFrame::ColumnDescription{reg, uint8_t(sizeof(PartType)), std::is_signed_v<PartType>};
+			}
+		}
+	}, FullLayout{});
+	return description;
+}
+
+}
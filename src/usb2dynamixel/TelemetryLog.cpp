@@ -0,0 +1,439 @@
+#include "TelemetryLog.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace dynamixel::telemetry {
+namespace {
+
+template <typename T>
+void appendRaw(std::vector<std::byte>& out, T const& value) {
+	auto first = reinterpret_cast<std::byte const*>(&value);
+	out.insert(out.end(), first, first + sizeof(T));
+}
+
+template <typename T>
+auto readRaw(std::byte const* base, std::size_t size, std::size_t offset) -> T {
+	if (offset + sizeof(T) > size) {
+		throw std::runtime_error("telemetry log is truncated");
+	}
+	T value;
+	std::memcpy(&value, base + offset, sizeof(T));
+	return value;
+}
+
+auto readVarint(std::byte const*& pos, std::byte const* end) -> uint64_t {
+	uint64_t v;
+	if (not varint::get(pos, end, v)) {
+		throw std::runtime_error("telemetry log block is corrupt");
+	}
+	return v;
+}
+
+}
+
+LogWriter::LogWriter(std::string const& path, std::vector<TelemetryFrame::ColumnDescription> const& columns, std::vector<MotorID> motors, std::size_t keyframeInterval, std::size_t bufferSize)
+	: mColumnCount(columns.size())
+	, mMotors(std::move(motors))
+	, mKeyframeInterval(std::max<std::size_t>(1, keyframeInterval))
+	, mBufferSize(bufferSize)
+	, mSections(2 + columns.size())
+	, mLastValues(columns.size(), std::vector<int32_t>(mMotors.size(), 0))
+	, mPresent(mMotors.size())
+{
+	mFD = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (mFD < 0) {
+		throw std::runtime_error("cannot create telemetry log " + path + ": " + strerror(errno));
+	}
+
+	LogHeader header{LogMagic, LogVersion, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count(), uint32_t(columns.size()), uint32_t(mMotors.size())};
+	appendRaw(mBuffer, header);
+	for (auto const& d : columns) {
+		appendRaw(mBuffer, LogColumn{d.baseRegister, d.width, d.isSigned, {}});
+	}
+	for (auto motor : mMotors) {
+		appendRaw(mBuffer, motor);
+	}
+	mOffset = mBuffer.size();
+	mBuffer.reserve(mBufferSize);
+
+	mWriter = std::thread([this] { writerLoop(); });
+}
+
+LogWriter::~LogWriter() {
+	try {
+		close();
+	} catch (...) {
+	}
+}
+
+void LogWriter::append(std::chrono::nanoseconds _timestamp, TelemetryFrame const& frame) {
+	if (mFailed) {
+		close(); // throws the error of the writer thread
+	}
+	if (mFD < 0) {
+		throw std::runtime_error("telemetry log is closed");
+	}
+	if (frame.columns.size() != mColumnCount) {
+		throw std::runtime_error("frame does not match the columns of the telemetry log");
+	}
+	int64_t timestamp = _timestamp.count();
+	if (mBlockFrames == 0) {
+		mFirstTimestamp = timestamp;
+		mLastTimestamp  = timestamp;
+		for (auto& last : mLastValues) {
+			std::fill(begin(last), end(last), 0);
+		}
+	}
+	varint::put(mSections[0], varint::zigzag(timestamp - mLastTimestamp));
+	mLastTimestamp = timestamp;
+
+	// frame.motors is the ordered subset of the requested motors that answered
+	std::size_t f {0};
+	for (std::size_t m{0}; m < mMotors.size(); ++m) {
+		mPresent[m] = f < frame.motors.size() and frame.motors[f] == mMotors[m];
+		f += mPresent[m];
+	}
+	for (std::size_t m{0}; m < mMotors.size(); m += 8) {
+		uint8_t bits {0};
+		for (std::size_t i{m}; i < std::min(m + 8, mMotors.size()); ++i) {
+			bits |= mPresent[i] << (i - m);
+		}
+		mSections[1].push_back(std::byte{bits});
+	}
+
+	for (std::size_t c{0}; c < mColumnCount; ++c) {
+		auto const& values = frame.columns[c].values;
+		auto& last    = mLastValues[c];
+		auto& section = mSections[2 + c];
+		f = 0;
+		for (std::size_t m{0}; m < mMotors.size(); ++m) {
+			int32_t value = mPresent[m] ? values[f++] : last[m];
+			varint::put(section, varint::zigzag(int64_t(value) - last[m]));
+			last[m] = value;
+		}
+	}
+
+	++mFrames;
+	if (++mBlockFrames >= mKeyframeInterval) {
+		finishBlock();
+	}
+}
+
+void LogWriter::finishBlock() {
+	if (mBlockFrames == 0) {
+		return;
+	}
+	std::size_t payload {0};
+	for (auto const& section : mSections) {
+		payload += varint::size(section.size()) + section.size();
+	}
+
+	mIndex.push_back(IndexEntry{mFirstTimestamp, mLastTimestamp, mOffset, mBlockFrames, 0});
+	appendRaw(mBuffer, BlockHeader{BlockMagic, mBlockFrames, mFirstTimestamp, mLastTimestamp, uint32_t(payload), 0});
+	for (auto& section : mSections) {
+		varint::put(mBuffer, section.size());
+		mBuffer.insert(mBuffer.end(), section.begin(), section.end());
+		section.clear();
+	}
+	mOffset += sizeof(BlockHeader) + payload;
+	mBlockFrames = 0;
+
+	if (mBuffer.size() >= mBufferSize) {
+		enqueue(std::move(mBuffer));
+		mBuffer = {};
+		mBuffer.reserve(mBufferSize);
+	}
+}
+
+void LogWriter::enqueue(std::vector<std::byte>&& data) {
+	auto g = std::lock_guard(mQueueMutex);
+	if (not mError.empty()) {
+		return; // the writer thread has given up, close() reports the error
+	}
+	mQueue.emplace_back(std::move(data));
+	mQueueCV.notify_one();
+}
+
+void LogWriter::writerLoop() {
+	while (true) {
+		std::vector<std::byte> data;
+		{
+			auto lock = std::unique_lock(mQueueMutex);
+			mQueueCV.wait(lock, [&] { return mClosing or not mQueue.empty(); });
+			if (mQueue.empty()) {
+				return;
+			}
+			data = std::move(mQueue.front());
+			mQueue.pop_front();
+		}
+		std::size_t written {0};
+		while (written < data.size()) {
+			auto n = ::write(mFD, data.data() + written, data.size() - written);
+			if (n < 0 and errno == EINTR) {
+				continue;
+			}
+			if (n <= 0) {
+				auto g = std::lock_guard(mQueueMutex);
+				mError = "cannot write telemetry log: " + std::string(strerror(errno));
+				mQueue.clear();
+				mFailed = true;
+				return;
+			}
+			written += n;
+		}
+	}
+}
+
+void LogWriter::close() {
+	if (mFD < 0) {
+		return;
+	}
+	finishBlock();
+	auto indexOffset = mOffset;
+	for (auto const& entry : mIndex) {
+		appendRaw(mBuffer, entry);
+	}
+	appendRaw(mBuffer, LogFooter{mIndex.size(), indexOffset, FooterMagic, 0});
+	enqueue(std::move(mBuffer));
+	mBuffer = {};
+	{
+		auto g = std::lock_guard(mQueueMutex);
+		mClosing = true;
+		mQueueCV.notify_one();
+	}
+	mWriter.join();
+	::close(mFD);
+	mFD = -1;
+	if (not mError.empty()) {
+		throw std::runtime_error(mError);
+	}
+}
+
+LogBlock::LogBlock(std::byte const* payload, std::size_t payloadBytes, BlockHeader const& header, std::size_t columnCount, std::size_t motorCount)
+	: mMotorCount(motorCount)
+	, mColumns(columnCount)
+{
+	auto pos = payload;
+	auto end = payload + payloadBytes;
+	auto section = [&] {
+		std::size_t length = readVarint(pos, end);
+		if (length > std::size_t(end - pos)) {
+			throw std::runtime_error("telemetry log block is corrupt");
+		}
+		auto data = pos;
+		pos += length;
+		return std::make_pair(data, length);
+	};
+
+	// timestamps are small and needed for seeking, they are decoded right away
+	auto [timeData, timeLength] = section();
+	mTimestamps.reserve(header.frameCount);
+	int64_t timestamp = header.firstTimestamp;
+	for (auto tpos = timeData; mTimestamps.size() < header.frameCount;) {
+		timestamp += varint::unzigzag(readVarint(tpos, timeData + timeLength));
+		mTimestamps.push_back(timestamp);
+	}
+
+	auto [presence, presenceLength] = section();
+	if (presenceLength < header.frameCount * ((motorCount + 7) / 8)) {
+		throw std::runtime_error("telemetry log block is corrupt");
+	}
+	mPresence = presence;
+	for (std::size_t c{0}; c < columnCount; ++c) {
+		mColumnData.push_back(section());
+	}
+}
+
+bool LogBlock::present(std::size_t frame, std::size_t motor) const {
+	auto bytesPerFrame = (mMotorCount + 7) / 8;
+	return (uint8_t(mPresence[frame * bytesPerFrame + motor / 8]) >> (motor % 8)) & 1;
+}
+
+auto LogBlock::column(std::size_t c) const -> std::vector<int32_t> const& {
+	auto& decoded = mColumns.at(c);
+	if (not decoded) {
+		auto [pos, length] = mColumnData[c];
+		auto end = pos + length;
+		std::vector<int32_t> values(frameCount() * mMotorCount);
+		std::vector<int32_t> last(mMotorCount, 0);
+		for (std::size_t i{0}; i < values.size(); ++i) {
+			auto& l = last[i % mMotorCount];
+			l = int32_t(l + varint::unzigzag(readVarint(pos, end)));
+			values[i] = l;
+		}
+		decoded = std::move(values);
+	}
+	return *decoded;
+}
+
+LogReader::LogReader(std::string const& path) {
+	int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		throw std::runtime_error("cannot open telemetry log " + path + ": " + strerror(errno));
+	}
+	struct stat st;
+	if (::fstat(fd, &st) != 0) {
+		::close(fd);
+		throw std::runtime_error("cannot stat telemetry log " + path);
+	}
+	mSize = st.st_size;
+	if (mSize > 0) {
+		mAddress = ::mmap(nullptr, mSize, PROT_READ, MAP_PRIVATE, fd, 0);
+	}
+	::close(fd);
+	if (mSize == 0 or mAddress == MAP_FAILED) {
+		mAddress = nullptr;
+		throw std::runtime_error("cannot map telemetry log " + path);
+	}
+
+	try {
+		auto base   = static_cast<std::byte const*>(mAddress);
+		auto header = readRaw<LogHeader>(base, mSize, 0);
+		if (header.magic != LogMagic or header.version != LogVersion) {
+			throw std::runtime_error(path + " is not a telemetry log of version " + std::to_string(LogVersion));
+		}
+		mStartRealtime = header.startRealtime;
+		std::size_t offset = sizeof(LogHeader);
+		for (uint32_t c{0}; c < header.columnCount; ++c, offset += sizeof(LogColumn)) {
+			auto column = readRaw<LogColumn>(base, mSize, offset);
+			mColumns.push_back({column.baseRegister, column.width, bool(column.isSigned)});
+		}
+		for (uint32_t m{0}; m < header.motorCount; ++m, offset += sizeof(MotorID)) {
+			mMotors.push_back(readRaw<MotorID>(base, mSize, offset));
+		}
+		mBlocksOffset = offset;
+
+		std::optional<LogFooter> footer;
+		if (mSize >= mBlocksOffset + sizeof(LogFooter)) {
+			footer = readRaw<LogFooter>(base, mSize, mSize - sizeof(LogFooter));
+		}
+		if (footer and footer->magic == FooterMagic and footer->indexOffset + footer->blockCount * sizeof(IndexEntry) + sizeof(LogFooter) == mSize) {
+			mIndex.resize(footer->blockCount);
+			std::memcpy(mIndex.data(), base + footer->indexOffset, footer->blockCount * sizeof(IndexEntry));
+		} else {
+			scanBlocks();
+		}
+	} catch (...) {
+		::munmap(mAddress, mSize);
+		throw;
+	}
+}
+
+LogReader::~LogReader() {
+	::munmap(mAddress, mSize);
+}
+
+// find the blocks of a log without index by following the block headers, a partially written last block is ignored
+void LogReader::scanBlocks() {
+	auto base = static_cast<std::byte const*>(mAddress);
+	std::size_t offset = mBlocksOffset;
+	while (offset + sizeof(BlockHeader) <= mSize) {
+		auto header = readRaw<BlockHeader>(base, mSize, offset);
+		if (header.magic != BlockMagic or offset + sizeof(BlockHeader) + header.payloadBytes > mSize) {
+			break;
+		}
+		mIndex.push_back(IndexEntry{header.firstTimestamp, header.lastTimestamp, offset, header.frameCount, 0});
+		offset += sizeof(BlockHeader) + header.payloadBytes;
+	}
+}
+
+auto LogReader::frameCount() const -> uint64_t {
+	uint64_t count {0};
+	for (auto const& entry : mIndex) {
+		count += entry.frameCount;
+	}
+	return count;
+}
+
+auto LogReader::begin() const -> std::chrono::nanoseconds {
+	return std::chrono::nanoseconds{mIndex.empty() ? 0 : mIndex.front().firstTimestamp};
+}
+
+auto LogReader::end() const -> std::chrono::nanoseconds {
+	return std::chrono::nanoseconds{mIndex.empty() ? 0 : mIndex.back().lastTimestamp};
+}
+
+auto LogReader::findBlock(std::chrono::nanoseconds timestamp) const -> std::size_t {
+	auto iter = std::lower_bound(mIndex.begin(), mIndex.end(), timestamp.count(), [](IndexEntry const& entry, int64_t t) {
+		return entry.lastTimestamp < t;
+	});
+	return std::distance(mIndex.begin(), iter);
+}
+
+auto LogReader::block(std::size_t idx) const -> LogBlock {
+	auto const& entry = mIndex.at(idx);
+	auto base   = static_cast<std::byte const*>(mAddress);
+	auto header = readRaw<BlockHeader>(base, mSize, entry.offset);
+	if (header.magic != BlockMagic or entry.offset + sizeof(BlockHeader) + header.payloadBytes > mSize) {
+		throw std::runtime_error("telemetry log index points to an invalid block");
+	}
+	return LogBlock{base + entry.offset + sizeof(BlockHeader), header.payloadBytes, header, mColumns.size(), mMotors.size()};
+}
+
+void LogReader::replay(std::chrono::nanoseconds from, std::chrono::nanoseconds to, double speed, std::vector<int> const& registers, FrameCallback const& callback, std::atomic<bool> const& stop) const {
+	std::vector<std::size_t> selected;
+	std::vector<TelemetryFrame::ColumnDescription> descriptions;
+	for (std::size_t c{0}; c < mColumns.size(); ++c) {
+		if (registers.empty() or std::find(registers.begin(), registers.end(), mColumns[c].baseRegister) != registers.end()) {
+			selected.push_back(c);
+			descriptions.push_back(mColumns[c]);
+		}
+	}
+	if (selected.empty()) {
+		throw std::runtime_error("none of the requested registers is part of the telemetry log");
+	}
+	TelemetryFrame frame{descriptions};
+	frame.resize(mMotors.size());
+
+	std::optional<std::chrono::nanoseconds> firstTimestamp;
+	auto wallStart = std::chrono::steady_clock::now();
+	for (auto b = findBlock(from); b < mIndex.size() and mIndex[b].firstTimestamp <= to.count(); ++b) {
+		auto block = this->block(b);
+		for (std::size_t f{0}; f < block.frameCount(); ++f) {
+			auto timestamp = block.timestamp(f);
+			if (timestamp < from) {
+				continue;
+			}
+			if (timestamp > to or stop) {
+				return;
+			}
+			if (not firstTimestamp) {
+				firstTimestamp = timestamp;
+			}
+			if (speed > 0) {
+				auto due = wallStart + std::chrono::duration_cast<std::chrono::steady_clock::duration>((timestamp - *firstTimestamp) / speed);
+				std::this_thread::sleep_until(due);
+			}
+
+			std::size_t answered {0};
+			for (std::size_t m{0}; m < mMotors.size(); ++m) {
+				if (not block.present(f, m)) {
+					continue;
+				}
+				frame.motors[answered] = mMotors[m];
+				for (std::size_t i{0}; i < selected.size(); ++i) {
+					frame.columns[i].values[answered] = block.column(selected[i])[f * mMotors.size() + m];
+				}
+				++answered;
+			}
+			frame.motors.resize(answered);
+			frame.errorCodes.resize(answered);
+			for (auto& column : frame.columns) {
+				column.values.resize(answered);
+			}
+			callback(timestamp, frame);
+			frame.resize(mMotors.size());
+		}
+	}
+}
+
+}
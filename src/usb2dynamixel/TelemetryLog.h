@@ -0,0 +1,229 @@
+#pragma once
+
+#include "TelemetryFrame.h"
+#include "TelemetryPoller.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * append only, columnar log of telemetry frames
+ *
+ * file layout (all integers little endian):
+ *   LogHeader, columnCount * LogColumn, motorCount * MotorID
+ *   blocks:  BlockHeader, then 2 + columnCount sections, each prefixed by its byte length (varint)
+ *            section 0: timestamps, delta to the previous frame (zigzag varint, the first frame is relative to BlockHeader::firstTimestamp)
+ *            section 1: per frame a bitmap of the motors that answered
+ *            section 2+c: values of column c, per frame and motor the delta to the previous value of that motor (zigzag varint)
+ *   index:   blockCount * IndexEntry, LogFooter
+ *
+ * every block starts with a keyframe (all deltas are relative to 0), so a block can be decoded without its predecessors.
+ * A motor that did not answer repeats its last value.
+ * The index is written when the log is closed; if it is missing (e.g. after a crash) readers find the blocks by scanning their headers.
+ */
+namespace dynamixel::telemetry {
+
+constexpr uint32_t LogMagic    = 0x4c544958; // "XITL"
+constexpr uint32_t BlockMagic  = 0x4b4c4258; // "XBLK"
+constexpr uint32_t FooterMagic = 0x49544958; // "XITI"
+constexpr uint32_t LogVersion  = 1;
+
+#pragma pack(push, 1)
+struct LogHeader {
+	uint32_t magic;
+	uint32_t version;
+	int64_t  startRealtime;  // ns since the unix epoch when the log was created
+	uint32_t columnCount;
+	uint32_t motorCount;
+};
+
+struct LogColumn {
+	int32_t baseRegister;
+	uint8_t width;
+	uint8_t isSigned;
+	uint8_t padding[2];
+};
+
+struct BlockHeader {
+	uint32_t magic;
+	uint32_t frameCount;
+	int64_t  firstTimestamp; // ns, CLOCK_MONOTONIC
+	int64_t  lastTimestamp;
+	uint32_t payloadBytes;   // bytes of all sections following this header
+	uint32_t padding;
+};
+
+struct IndexEntry {
+	int64_t  firstTimestamp;
+	int64_t  lastTimestamp;
+	uint64_t offset;         // of the BlockHeader
+	uint32_t frameCount;
+	uint32_t padding;
+};
+
+struct LogFooter {
+	uint64_t blockCount;
+	uint64_t indexOffset;
+	uint32_t magic;
+	uint32_t padding;
+};
+#pragma pack(pop)
+
+namespace varint {
+	[[nodiscard]] inline auto zigzag(int64_t v) -> uint64_t { return (uint64_t(v) << 1) ^ uint64_t(v >> 63); }
+	[[nodiscard]] inline auto unzigzag(uint64_t v) -> int64_t { return int64_t(v >> 1) ^ -int64_t(v & 1); }
+
+	[[nodiscard]] inline auto size(uint64_t v) -> std::size_t {
+		std::size_t n {1};
+		for (; v >= 0x80; v >>= 7) {
+			++n;
+		}
+		return n;
+	}
+
+	inline void put(std::vector<std::byte>& out, uint64_t v) {
+		while (v >= 0x80) {
+			out.push_back(std::byte(v | 0x80));
+			v >>= 7;
+		}
+		out.push_back(std::byte(v));
+	}
+
+	// returns false if the data ends within the number
+	inline bool get(std::byte const*& pos, std::byte const* end, uint64_t& v) {
+		v = 0;
+		for (int shift{0}; pos != end and shift < 64; shift += 7) {
+			auto b = uint8_t(*pos++);
+			v |= uint64_t(b & 0x7f) << shift;
+			if (not (b & 0x80)) {
+				return true;
+			}
+		}
+		return false;
+	}
+}
+
+struct LogWriter {
+	/**
+	 * creates (truncates) path
+	 * a block (and keyframe) is started every keyframeInterval frames, the file is written in chunks of at least bufferSize bytes by a background thread
+	 */
+	LogWriter(std::string const& path, std::vector<TelemetryFrame::ColumnDescription> const& columns, std::vector<MotorID> motors, std::size_t keyframeInterval = 1000, std::size_t bufferSize = 1<<20);
+	~LogWriter();
+
+	LogWriter(LogWriter const&) = delete;
+	LogWriter& operator=(LogWriter const&) = delete;
+
+	// frame must hold the columns the log was created with, motors not in the log are ignored
+	void append(std::chrono::nanoseconds timestamp, TelemetryFrame const& frame);
+
+	// writes all pending frames and the index, called by the destructor
+	void close();
+
+	[[nodiscard]] auto getFramesWritten() const -> uint64_t { return mFrames; }
+	[[nodiscard]] auto getBytesWritten() const -> uint64_t { return mOffset; }
+
+private:
+	void finishBlock();
+	void enqueue(std::vector<std::byte>&& data);
+	void writerLoop();
+
+	int                                 mFD {-1};
+	std::size_t                         mColumnCount;
+	std::vector<MotorID>                mMotors;
+	std::size_t                         mKeyframeInterval;
+	std::size_t                         mBufferSize;
+
+	// the block that is currently built
+	uint32_t                            mBlockFrames {0};
+	int64_t                             mFirstTimestamp {0};
+	int64_t                             mLastTimestamp {0};
+	std::vector<std::vector<std::byte>> mSections;
+	std::vector<std::vector<int32_t>>   mLastValues;   // [column][motor]
+	std::vector<uint8_t>                mPresent;      // scratch: motors of the current frame
+
+	std::vector<IndexEntry>             mIndex;
+	uint64_t                            mOffset {0};   // file offset of the next byte appended
+	uint64_t                            mFrames {0};
+	std::vector<std::byte>              mBuffer;       // blocks not yet handed to the writer thread
+
+	std::mutex                          mQueueMutex;
+	std::condition_variable             mQueueCV;
+	std::deque<std::vector<std::byte>>  mQueue;
+	bool                                mClosing {false};
+	std::string                         mError;
+	std::atomic<bool>                   mFailed {false};
+	std::thread                         mWriter;
+};
+
+/**
+ * one block of a log, columns are decoded on first access
+ */
+struct LogBlock {
+	LogBlock(std::byte const* payload, std::size_t payloadBytes, BlockHeader const& header, std::size_t columnCount, std::size_t motorCount);
+
+	[[nodiscard]] auto frameCount() const -> std::size_t { return mTimestamps.size(); }
+	[[nodiscard]] auto timestamp(std::size_t frame) const -> std::chrono::nanoseconds { return std::chrono::nanoseconds{mTimestamps[frame]}; }
+	[[nodiscard]] bool present(std::size_t frame, std::size_t motor) const;
+
+	// values of all motors (motor major within a frame): column(c)[frame * motorCount + motor]
+	[[nodiscard]] auto column(std::size_t c) const -> std::vector<int32_t> const&;
+
+private:
+	std::size_t                                              mMotorCount;
+	std::vector<int64_t>                                     mTimestamps;
+	std::byte const*                                         mPresence;
+	std::vector<std::pair<std::byte const*, std::size_t>>    mColumnData; // encoded sections
+	mutable std::vector<std::optional<std::vector<int32_t>>> mColumns;    // decoded sections
+};
+
+struct LogReader {
+	// maps path, reads the index (or rebuilds it by scanning the blocks if the log was not closed properly)
+	explicit LogReader(std::string const& path);
+	~LogReader();
+
+	LogReader(LogReader const&) = delete;
+	LogReader& operator=(LogReader const&) = delete;
+
+	[[nodiscard]] auto columns() const -> std::vector<TelemetryFrame::ColumnDescription> const& { return mColumns; }
+	[[nodiscard]] auto motors() const -> std::vector<MotorID> const& { return mMotors; }
+	[[nodiscard]] auto index() const -> std::vector<IndexEntry> const& { return mIndex; }
+	[[nodiscard]] auto startRealtime() const -> std::chrono::nanoseconds { return std::chrono::nanoseconds{mStartRealtime}; }
+	[[nodiscard]] auto frameCount() const -> uint64_t;
+
+	// timestamps of the first and last frame
+	[[nodiscard]] auto begin() const -> std::chrono::nanoseconds;
+	[[nodiscard]] auto end() const -> std::chrono::nanoseconds;
+
+	// the block holding the first frame at or after timestamp (binary search over the index), blockCount if there is none
+	[[nodiscard]] auto findBlock(std::chrono::nanoseconds timestamp) const -> std::size_t;
+	[[nodiscard]] auto block(std::size_t idx) const -> LogBlock;
+
+	/**
+	 * replay all frames in [from, to] into callback, with their original timestamps
+	 * speed scales the pacing (2: twice as fast), speed <= 0 replays as fast as possible
+	 * only the columns in registers are decoded (all if empty)
+	 */
+	void replay(std::chrono::nanoseconds from, std::chrono::nanoseconds to, double speed, std::vector<int> const& registers, FrameCallback const& callback, std::atomic<bool> const& stop) const;
+
+private:
+	void scanBlocks();
+
+	void*                                          mAddress {nullptr};
+	std::size_t                                    mSize {0};
+	int64_t                                        mStartRealtime {0};
+	std::vector<TelemetryFrame::ColumnDescription> mColumns;
+	std::vector<MotorID>                           mMotors;
+	std::size_t                                    mBlocksOffset {0};
+	std::vector<IndexEntry>                        mIndex;
+};
+
+}
@@ -0,0 +1,35 @@
+#include "TelemetryPoller.h"
+
+#include <simplyfile/Timer.h>
+
+#include <stdexcept>
+
+namespace dynamixel {
+
+TelemetryPoller::TelemetryPoller(USB2Dynamixel const& usb2dyn, std::vector<MotorID> motors, TelemetryFrame frame, std::chrono::nanoseconds period, USB2Dynamixel::Timeout timeout)
+	: mUsb2Dyn(usb2dyn)
+	, mMotors(std::move(motors))
+	, mFrame(std::move(frame))
+	, mPeriod(period)
+	, mTimeout(timeout)
+{
+	if (mPeriod <= std::chrono::nanoseconds{0}) {
+		throw std::runtime_error("the poll period must be positive");
+	}
+}
+
+void TelemetryPoller::run(FrameCallback const& callback, std::atomic<bool> const& stop) {
+	auto timer = simplyfile::Timer{mPeriod, false, 0};
+	while (not stop) {
+		mUsb2Dyn.sync_read(mMotors, mFrame, mTimeout);
+		auto now = std::chrono::steady_clock::now().time_since_epoch();
+		callback(std::chrono::duration_cast<std::chrono::nanoseconds>(now), mFrame);
+
+		int expirations = timer.getElapsed();
+		if (expirations > 1) {
+			mOverruns += expirations - 1;
+		}
+	}
+}
+
+}
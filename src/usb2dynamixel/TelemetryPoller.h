@@ -0,0 +1,38 @@
+#pragma once
+
+#include "USB2Dynamixel.h"
+#include "TelemetryFrame.h"
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <vector>
+
+namespace dynamixel {
+
+// receives every polled (or replayed) frame, timestamp is CLOCK_MONOTONIC (steady_clock) of the moment the frame was read
+using FrameCallback = std::function<void(std::chrono::nanoseconds timestamp, TelemetryFrame const& frame)>;
+
+/**
+ * reads the registers of frame from all motors at a fixed rate (timerfd driven)
+ * uses sync_read, which is a bulk read where SYNC_READ is not available
+ */
+struct TelemetryPoller {
+	TelemetryPoller(USB2Dynamixel const& usb2dyn, std::vector<MotorID> motors, TelemetryFrame frame, std::chrono::nanoseconds period, USB2Dynamixel::Timeout timeout);
+
+	// poll until stop becomes true
+	void run(FrameCallback const& callback, std::atomic<bool> const& stop);
+
+	// number of periods that passed without a poll because reading took too long
+	[[nodiscard]] auto getOverruns() const -> uint64_t { return mOverruns; }
+
+private:
+	USB2Dynamixel const&     mUsb2Dyn;
+	std::vector<MotorID>     mMotors;
+	TelemetryFrame           mFrame;
+	std::chrono::nanoseconds mPeriod;
+	USB2Dynamixel::Timeout   mTimeout;
+	std::atomic<uint64_t>    mOverruns {0};
+};
+
+}
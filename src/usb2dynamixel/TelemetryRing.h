@@ -0,0 +1,268 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * a ring of telemetry frames in shared memory (shm_open), written by a single process and read by any number of processes
+ *
+ * this header has no dependencies besides the standard library and posix, consumers can copy it into their own projects.
+ *
+ * memory layout:
+ *   RingHeader
+ *   slotCount * (SlotHeader, MotorCount motor ids (uint8_t), padding to 4 bytes, columnCount * motorCount int32_t values)
+ *
+ * every slot is protected by a sequence counter (seqlock): it is odd while the writer updates the slot.
+ * A reader copies a slot and checks that the counter was even and did not change meanwhile, otherwise it retries.
+ * Reading needs no syscalls and never blocks the writer.
+ */
+namespace dynamixel::telemetry {
+
+constexpr uint32_t RingMagic   = 0x4c455458; // "XTEL"
+constexpr uint32_t RingVersion = 1;
+constexpr std::size_t MaxColumns = 32;
+
+struct ColumnInfo {
+	int32_t baseRegister;
+	uint8_t width;
+	uint8_t isSigned;
+	uint8_t padding[2];
+};
+
+struct RingHeader {
+	uint32_t              magic;
+	uint32_t              version;
+	uint32_t              slotCount;
+	uint32_t              slotSize;     // bytes per slot including its SlotHeader
+	uint32_t              maxMotors;
+	uint32_t              columnCount;
+	std::atomic<uint64_t> framesWritten;
+	ColumnInfo            columns[MaxColumns];
+};
+
+struct SlotHeader {
+	std::atomic<uint64_t> sequence;
+	uint64_t              frame;
+	int64_t               timestampNs;  // CLOCK_MONOTONIC
+	uint32_t              motorCount;
+	uint32_t              padding;
+};
+
+[[nodiscard]] inline auto slotSize(std::size_t maxMotors, std::size_t columnCount) -> std::size_t {
+	auto idBytes = (maxMotors + 3) / 4 * 4;
+	auto size    = sizeof(SlotHeader) + idBytes + columnCount * maxMotors * sizeof(int32_t);
+	return (size + 63) / 64 * 64; // one slot per cache line group
+}
+
+// one decoded frame
+struct Snapshot {
+	uint64_t                          frame {0};
+	int64_t                           timestampNs {0};
+	std::vector<uint8_t>              motors;
+	std::vector<std::vector<int32_t>> columns; // columns[c][m] value of column c of motor m
+};
+
+namespace detail {
+
+struct Mapping {
+	Mapping() = default;
+	Mapping(Mapping const&) = delete;
+	Mapping& operator=(Mapping const&) = delete;
+	~Mapping() {
+		if (address) {
+			::munmap(address, size);
+		}
+	}
+	void map(int fd, std::size_t _size, int prot) {
+		size    = _size;
+		address = ::mmap(nullptr, size, prot, MAP_SHARED, fd, 0);
+		if (address == MAP_FAILED) {
+			address = nullptr;
+			throw std::runtime_error("cannot map telemetry ring");
+		}
+	}
+	void*       address {nullptr};
+	std::size_t size {0};
+};
+
+}
+
+struct RingWriter {
+	RingWriter(std::string const& name, std::vector<ColumnInfo> const& columns, std::size_t maxMotors, std::size_t slotCount)
+		: mName(name)
+	{
+		if (columns.size() > MaxColumns or columns.empty()) {
+			throw std::runtime_error("a telemetry ring needs between 1 and " + std::to_string(MaxColumns) + " columns");
+		}
+		if (slotCount == 0) {
+			throw std::runtime_error("a telemetry ring needs at least one slot");
+		}
+		auto size = sizeof(RingHeader) + slotCount * slotSize(maxMotors, columns.size());
+		int fd = ::shm_open(name.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0644);
+		if (fd < 0) {
+			throw std::runtime_error("cannot create shared memory " + name);
+		}
+		if (::ftruncate(fd, size) != 0) {
+			::close(fd);
+			throw std::runtime_error("cannot resize shared memory " + name);
+		}
+		mMapping.map(fd, size, PROT_READ | PROT_WRITE);
+		::close(fd);
+
+		auto header = new (mMapping.address) RingHeader{};
+		header->version     = RingVersion;
+		header->slotCount   = slotCount;
+		header->slotSize    = slotSize(maxMotors, columns.size());
+		header->maxMotors   = maxMotors;
+		header->columnCount = columns.size();
+		std::copy(columns.begin(), columns.end(), header->columns);
+		for (std::size_t i{0}; i < slotCount; ++i) {
+			new (slot(i)) SlotHeader{};
+		}
+		// readers check the magic last
+		std::atomic_thread_fence(std::memory_order_release);
+		header->magic = RingMagic;
+	}
+
+	~RingWriter() {
+		::shm_unlink(mName.c_str());
+	}
+
+	// columns[c] points to motorCount values of column c
+	void publish(uint8_t const* motors, std::size_t motorCount, int32_t const* const* columns, int64_t timestampNs) {
+		auto header = this->header();
+		motorCount  = std::min<std::size_t>(motorCount, header->maxMotors);
+		uint64_t frame = header->framesWritten.load(std::memory_order_relaxed);
+		auto slotHeader = slot(frame % header->slotCount);
+
+		auto seq = slotHeader->sequence.load(std::memory_order_relaxed);
+		slotHeader->sequence.store(seq + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+
+		slotHeader->frame       = frame;
+		slotHeader->timestampNs = timestampNs;
+		slotHeader->motorCount  = motorCount;
+		auto data = reinterpret_cast<std::byte*>(slotHeader + 1);
+		std::memcpy(data, motors, motorCount);
+		auto values = reinterpret_cast<int32_t*>(data + (header->maxMotors + 3) / 4 * 4);
+		for (std::size_t c{0}; c < header->columnCount; ++c) {
+			std::memcpy(values + c * header->maxMotors, columns[c], motorCount * sizeof(int32_t));
+		}
+
+		slotHeader->sequence.store(seq + 2, std::memory_order_release);
+		header->framesWritten.store(frame + 1, std::memory_order_release);
+	}
+
+private:
+	auto header() -> RingHeader* {
+		return static_cast<RingHeader*>(mMapping.address);
+	}
+	auto slot(std::size_t idx) -> SlotHeader* {
+		auto base = static_cast<std::byte*>(mMapping.address) + sizeof(RingHeader);
+		return reinterpret_cast<SlotHeader*>(base + idx * header()->slotSize);
+	}
+
+	std::string     mName;
+	detail::Mapping mMapping;
+};
+
+struct RingReader {
+	explicit RingReader(std::string const& name) {
+		int fd = ::shm_open(name.c_str(), O_RDONLY, 0);
+		if (fd < 0) {
+			throw std::runtime_error("no telemetry ring " + name);
+		}
+		struct stat st;
+		if (::fstat(fd, &st) != 0 or std::size_t(st.st_size) < sizeof(RingHeader)) {
+			::close(fd);
+			throw std::runtime_error("telemetry ring " + name + " is not initialized");
+		}
+		mMapping.map(fd, st.st_size, PROT_READ);
+		::close(fd);
+		if (header()->magic != RingMagic or header()->version != RingVersion) {
+			throw std::runtime_error("telemetry ring " + name + " has an unknown format");
+		}
+		std::atomic_thread_fence(std::memory_order_acquire);
+	}
+
+	[[nodiscard]] auto columns() const -> std::vector<ColumnInfo> {
+		return {header()->columns, header()->columns + header()->columnCount};
+	}
+
+	// number of frames published so far
+	[[nodiscard]] auto framesWritten() const -> uint64_t {
+		return header()->framesWritten.load(std::memory_order_acquire);
+	}
+
+	// copies the newest frame into snapshot, returns false if there is none (yet)
+	// snapshot keeps its capacity, so repeated reads do not allocate
+	bool latest(Snapshot& snapshot) const {
+		while (true) {
+			auto written = framesWritten();
+			if (written == 0) {
+				return false;
+			}
+			if (read(written - 1, snapshot)) {
+				return true;
+			}
+		}
+	}
+
+	// copies frame into snapshot, returns false if the frame is not in the ring (anymore)
+	bool read(uint64_t frame, Snapshot& snapshot) const {
+		auto h = header();
+		if (frame >= framesWritten() or frame + h->slotCount < framesWritten()) {
+			return false;
+		}
+		auto slotHeader = slot(frame % h->slotCount);
+		while (true) {
+			auto seq1 = slotHeader->sequence.load(std::memory_order_acquire);
+			if (seq1 & 1) {
+				continue; // the writer is updating this slot
+			}
+			if (slotHeader->frame != frame) {
+				return false;
+			}
+			std::size_t motorCount = std::min<std::size_t>(slotHeader->motorCount, h->maxMotors);
+			snapshot.frame       = slotHeader->frame;
+			snapshot.timestampNs = slotHeader->timestampNs;
+			auto data = reinterpret_cast<std::byte const*>(slotHeader + 1);
+			snapshot.motors.resize(motorCount);
+			std::memcpy(snapshot.motors.data(), data, motorCount);
+			auto values = reinterpret_cast<int32_t const*>(data + (h->maxMotors + 3) / 4 * 4);
+			snapshot.columns.resize(h->columnCount);
+			for (std::size_t c{0}; c < h->columnCount; ++c) {
+				snapshot.columns[c].resize(motorCount);
+				std::memcpy(snapshot.columns[c].data(), values + c * h->maxMotors, motorCount * sizeof(int32_t));
+			}
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (slotHeader->sequence.load(std::memory_order_relaxed) == seq1) {
+				return snapshot.frame == frame;
+			}
+		}
+	}
+
+private:
+	auto header() const -> RingHeader const* {
+		return static_cast<RingHeader const*>(mMapping.address);
+	}
+	auto slot(std::size_t idx) const -> SlotHeader const* {
+		auto base = static_cast<std::byte const*>(mMapping.address) + sizeof(RingHeader);
+		return reinterpret_cast<SlotHeader const*>(base + idx * header()->slotSize);
+	}
+
+	detail::Mapping mMapping;
+};
+
+}
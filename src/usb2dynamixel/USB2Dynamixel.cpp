@@ -8,17 +8,45 @@
 #include <thread>
 
 #include <simplyfile/SerialPort.h>
+#include "AdapterProfile.h"
 #include "ProtocolV1.h"
 #include "ProtocolV2.h"
+#include "MotorMetaInfo.h"
 #include "file_io.h"
 
 namespace dynamixel {
+namespace {
 
-USB2Dynamixel::USB2Dynamixel(int baudrate, std::string const& device, Protocol protocol)
-	: mPort(device, baudrate)
+void checkUniqueMotors(std::vector<std::tuple<MotorID, int, Parameter>> const& motors, std::string const& what) {
+	std::set<MotorID> seen;
+	for (auto const& [id, baseRegister, params] : motors) {
+		if (not seen.insert(id).second) {
+			throw std::runtime_error(what + ": motor " + std::to_string(id) + " can only be addressed once");
+		}
+	}
+}
+
+}
+
+USB2Dynamixel::USB2Dynamixel(int baudrate, std::string const& device, Protocol protocol, bool useDaemon)
+	: mBaudrate(baudrate)
+	, mProtocolVersion(protocol)
+	, mRemote(useDaemon ? remote::Client::connect(remote::socketPath(device)) : nullptr)
+	, mPort(mRemote ? simplyfile::SerialPort{} : simplyfile::SerialPort{device, baudrate})
 {
-	file_io::flushRead(mPort);
-	if (protocol == Protocol::V1) {
+	if (mRemote) {
+		auto hello = mRemote->transact({});
+		if (int(hello.baudrate) != baudrate or Protocol(hello.protocol) != protocol) {
+			throw std::runtime_error("the daemon serving " + device + " uses baudrate " + std::to_string(hello.baudrate)
+			                         + " and protocol version " + std::to_string(hello.protocol) + ", not "
+			                         + std::to_string(baudrate) + " and " + std::to_string(int(protocol)));
+		}
+	} else {
+		adapter::applyProfile(device);
+		file_io::setCapturedFD(mPort);
+		file_io::flushRead(mPort);
+	}
+	if (mProtocolVersion == Protocol::V1) {
 		mProtocol = std::make_unique<ProtocolV1>();
 	} else {
 		mProtocol = std::make_unique<ProtocolV2>();
@@ -26,16 +54,28 @@ USB2Dynamixel::USB2Dynamixel(int baudrate, std::string const& device, Protocol p
 }
 
 USB2Dynamixel::~USB2Dynamixel() {
+	if (not mRemote) {
+		file_io::releaseCapturedFD(mPort);
+	}
 }
 
 bool USB2Dynamixel::ping(MotorID motor, Timeout timeout) const {
+	if (mRemote) {
+		auto response = mRemote->transact({remote::Op::Ping, motor, 0, 0, timeout, {}, {}, {}});
+		return response.motor != MotorIDInvalid;
+	}
 	auto g = std::lock_guard(mMutex);
-	file_io::write(mPort, mProtocol->createPacket(motor, Instruction::PING, {}));
-	auto [timeoutFlag, motorID, errorCode, rxBuf] = mProtocol->readPacket(timeout, motor, 0, mPort);
+	send(motor, Instruction::PING, {});
+	// protocol 2 motors answer with their model number and firmware version
+	auto [timeoutFlag, motorID, errorCode, rxBuf] = receive(motor, mProtocolVersion == Protocol::V2 ? 3 : 0, timeout);
 	return motorID != MotorIDInvalid;
 }
 
 auto USB2Dynamixel::read(MotorID motor, int baseRegister, size_t length, Timeout timeout) const -> std::tuple<bool, MotorID, ErrorCode, Parameter> {
+	if (mRemote) {
+		auto response = mRemote->transact({remote::Op::Read, motor, baseRegister, length, timeout, {}, {}, {}});
+		return std::make_tuple(response.timeout, response.motor, response.errorCode, std::move(response.data));
+	}
 	std::vector<std::byte> txBuf;
 	for (auto b : mProtocol->convertAddress(baseRegister)) {
 		txBuf.push_back(b);
@@ -45,11 +85,14 @@ auto USB2Dynamixel::read(MotorID motor, int baseRegister, size_t length, Timeout
 	}
 
 	auto g = std::lock_guard(mMutex);
-	file_io::write(mPort, mProtocol->createPacket(motor, Instruction::READ, txBuf));
-	return mProtocol->readPacket(timeout, motor, length, mPort);
+	send(motor, Instruction::READ, txBuf);
+	return receive(motor, length, timeout);
 }
 
 auto USB2Dynamixel::bulk_read(std::vector<std::tuple<MotorID, int, size_t>> const& motors, Timeout timeout) const -> std::vector<std::tuple<MotorID, int, ErrorCode, Parameter>> {
+	if (mRemote) {
+		return mRemote->transact({remote::Op::BulkRead, BroadcastID, 0, 0, timeout, {}, motors, {}}).reads;
+	}
 
 	std::vector<std::tuple<MotorID, int, ErrorCode, Parameter>> resList;
 	resList.reserve(motors.size());
@@ -57,10 +100,10 @@ auto USB2Dynamixel::bulk_read(std::vector<std::tuple<MotorID, int, size_t>> cons
 	auto txBuf = mProtocol->buildBulkReadPackage(motors);
 
 	auto g = std::lock_guard(mMutex);
-	file_io::write(mPort, mProtocol->createPacket(BroadcastID, Instruction::BULK_READ, txBuf));
+	send(BroadcastID, Instruction::BULK_READ, txBuf);
 
 	for (auto const& [id, baseRegister, length] : motors) {
-		auto [timeoutFlag, motorID, errorCode, rxBuf] = mProtocol->readPacket(timeout, id, length, mPort);
+		auto [timeoutFlag, motorID, errorCode, rxBuf] = receive(id, length, timeout);
 		if (motorID == MotorIDInvalid or motorID != id) {
 			break;
 		}
@@ -69,24 +112,160 @@ auto USB2Dynamixel::bulk_read(std::vector<std::tuple<MotorID, int, size_t>> cons
 	return resList;
 }
 
+void USB2Dynamixel::bulk_read(std::vector<MotorID> const& motors, TelemetryFrame& frame, Timeout timeout) const {
+	std::vector<std::tuple<MotorID, int, size_t>> request;
+	request.reserve(motors.size());
+	for (auto id : motors) {
+		request.push_back(std::make_tuple(id, frame.windowBase(), frame.windowLength()));
+	}
+	frame.resize(motors.size());
+
+	std::size_t received {0};
+	if (mRemote) {
+		for (auto const& [id, baseRegister, errorCode, rxBuf] : bulk_read(request, timeout)) {
+			if (rxBuf.size() != frame.windowLength()) {
+				break;
+			}
+			frame.motors[received]     = id;
+			frame.errorCodes[received] = errorCode;
+			std::memcpy(frame.rawWindow(received), rxBuf.data(), frame.windowLength());
+			++received;
+		}
+	} else {
+		auto txBuf = mProtocol->buildBulkReadPackage(request);
+		auto g = std::lock_guard(mMutex);
+		send(BroadcastID, Instruction::BULK_READ, txBuf);
+		received = receiveFrame(motors, frame, timeout);
+	}
+	frame.unpack(received);
+}
+
+void USB2Dynamixel::sync_read(std::vector<MotorID> const& motors, TelemetryFrame& frame, Timeout timeout) const {
+	// SYNC_READ only exists in protocol 2, the daemon executes bulk reads (and merges them)
+	if (mRemote or mProtocolVersion != Protocol::V2) {
+		bulk_read(motors, frame, timeout);
+		return;
+	}
+	Parameter txBuf;
+	for (auto b : mProtocol->convertAddress(frame.windowBase())) {
+		txBuf.push_back(b);
+	}
+	for (auto b : mProtocol->convertLength(frame.windowLength())) {
+		txBuf.push_back(b);
+	}
+	for (auto id : motors) {
+		txBuf.push_back(std::byte{id});
+	}
+	frame.resize(motors.size());
+
+	std::size_t received {0};
+	{
+		auto g = std::lock_guard(mMutex);
+		send(BroadcastID, Instruction::SYNC_READ, txBuf);
+		received = receiveFrame(motors, frame, timeout);
+	}
+	frame.unpack(received);
+}
+
+auto USB2Dynamixel::receiveFrame(std::vector<MotorID> const& motors, TelemetryFrame& frame, Timeout timeout) const -> std::size_t {
+	std::size_t received {0};
+	for (auto id : motors) {
+		auto [timeoutFlag, motorID, errorCode, rxBuf] = receive(id, frame.windowLength(), timeout);
+		if (motorID == MotorIDInvalid or motorID != id or rxBuf.size() != frame.windowLength()) {
+			break;
+		}
+		frame.motors[received]     = motorID;
+		frame.errorCodes[received] = errorCode;
+		std::memcpy(frame.rawWindow(received), rxBuf.data(), frame.windowLength());
+		++received;
+	}
+	return received;
+}
+
+void USB2Dynamixel::send(MotorID motor, Instruction instruction, Parameter const& parameters) const {
+	auto packet = mProtocol->createPacket(motor, instruction, parameters);
+	file_io::write(mPort, packet);
+	mLast = LastInstruction{instruction, motor, std::chrono::steady_clock::now()};
+	mStatistics.sent(instruction, motor, packet.size());
+}
+
+auto USB2Dynamixel::receive(MotorID motor, std::size_t numParameters, Timeout timeout) const -> std::tuple<bool, MotorID, ErrorCode, Parameter> {
+	auto before = mProtocol->getReceiveStatistics();
+	auto result = mProtocol->readPacket(timeout, motor, numParameters, mPort);
+	auto after  = mProtocol->getReceiveStatistics();
+	auto const& [timeoutFlag, motorID, errorCode, rxBuf] = result;
+	mStatistics.received(mLast.instruction, BusStatistics::Reception{
+		motor,
+		timeoutFlag or motorID != motor,
+		errorCode,
+		std::chrono::steady_clock::now() - mLast.sent,
+		mLast.motor == BroadcastID,
+		{after.bytes - before.bytes, after.resyncs - before.resyncs, after.checksumFailures - before.checksumFailures}
+	});
+	return result;
+}
+
 void USB2Dynamixel::write(MotorID motor, int baseRegister, Parameter const& txBuf) const {
+	if (mRemote) {
+		noteWrite(motor, baseRegister, txBuf);
+		mRemote->transact({remote::Op::Write, motor, baseRegister, 0, {}, txBuf, {}, {}});
+		return;
+	}
 	std::vector<std::byte> parameters;
 	for (auto b : mProtocol->convertAddress(baseRegister)) {
 		parameters.push_back(b);
 	}
 	parameters.insert(parameters.end(), txBuf.begin(), txBuf.end());
+	noteWrite(motor, baseRegister, txBuf);
 	auto g = std::lock_guard(mMutex);
-	file_io::write(mPort, mProtocol->createPacket(motor, Instruction::WRITE, parameters));
+	send(motor, Instruction::WRITE, parameters);
 }
+
 auto USB2Dynamixel::writeRead(MotorID motor, int baseRegister, Parameter const& txBuf, Timeout timeout) const -> std::tuple<bool, MotorID, ErrorCode, Parameter> {
+	auto level = statusReturnLevel(motor, timeout);
+
+	std::vector<std::byte> parameters;
+	for (auto b : mProtocol->convertAddress(baseRegister)) {
+		parameters.push_back(b);
+	}
+	parameters.insert(parameters.end(), txBuf.begin(), txBuf.end());
+	noteWrite(motor, baseRegister, txBuf);
+
+	if (mRemote) {
+		if (level and level != StatusReturnLevel::All) {
+			mRemote->transact({remote::Op::Write, motor, baseRegister, 0, {}, txBuf, {}, {}});
+			return std::make_tuple(false, motor, ErrorCode{}, Parameter{});
+		}
+		auto response = mRemote->transact({remote::Op::WriteRead, motor, baseRegister, 0, timeout, txBuf, {}, {}});
+		return std::make_tuple(response.timeout, response.motor, response.errorCode, std::move(response.data));
+	}
+
+	auto g = std::lock_guard(mMutex);
+	send(motor, Instruction::WRITE, parameters);
+	if (level and level != StatusReturnLevel::All) {
+		// no status packet will come, don't wait for it
+		return std::make_tuple(false, motor, ErrorCode{}, Parameter{});
+	}
+	return receive(motor, 0, timeout);
+}
+
+bool USB2Dynamixel::writeVerified(MotorID motor, int baseRegister, Parameter const& txBuf, Timeout timeout) const {
+	auto level = statusReturnLevel(motor, timeout);
+	if (level == StatusReturnLevel::All) {
+		auto [timeoutFlag, motorID, errorCode, rxBuf] = writeRead(motor, baseRegister, txBuf, timeout);
+		return not timeoutFlag and motorID == motor;
+	}
+	if (level == StatusReturnLevel::PingOnly) {
+		throw std::runtime_error("motor " + std::to_string(motor) + " only answers pings, writes can't be verified");
+	}
+	// the motor answers reads only: read the register back
 	write(motor, baseRegister, txBuf);
-	return mProtocol->readPacket(timeout, motor, 0, mPort);
+	auto [timeoutFlag, motorID, errorCode, rxBuf] = read(motor, baseRegister, txBuf.size(), timeout);
+	return not timeoutFlag and motorID == motor and rxBuf == txBuf;
 }
 
 
 void USB2Dynamixel::sync_write(std::map<MotorID, Parameter> const& motorParams, int baseRegister) const {
-	auto g = std::lock_guard(mMutex);
-
 	if (motorParams.empty()) {
 		throw std::runtime_error("sync_write: motorParams can't be empty");
 	}
@@ -100,6 +279,16 @@ void USB2Dynamixel::sync_write(std::map<MotorID, Parameter> const& motorParams,
 		throw std::runtime_error("sync_write: data is not consistent");
 	}
 
+	if (mRemote) {
+		remote::Request request{remote::Op::SyncWrite, BroadcastID, baseRegister, len, {}, {}, {}, {}};
+		for (auto const& [id, params] : motorParams) {
+			request.writes.emplace_back(id, baseRegister, params);
+			noteWrite(id, baseRegister, params);
+		}
+		mRemote->transact(request);
+		return;
+	}
+
 	Parameter txBuf;
 	for (auto b : mProtocol->convertAddress(baseRegister)) {
 		txBuf.push_back(b);
@@ -111,20 +300,250 @@ void USB2Dynamixel::sync_write(std::map<MotorID, Parameter> const& motorParams,
 	for (auto const& [id, params] : motorParams) {
 		txBuf.push_back(std::byte{id});
 		txBuf.insert(txBuf.end(), params.begin(), params.end());
+		noteWrite(id, baseRegister, params);
 	}
 
-	file_io::write(mPort, mProtocol->createPacket(BroadcastID, Instruction::SYNC_WRITE, txBuf));
+	auto g = std::lock_guard(mMutex);
+	send(BroadcastID, Instruction::SYNC_WRITE, txBuf);
+}
+
+void USB2Dynamixel::bulk_write(std::vector<std::tuple<MotorID, int, Parameter>> const& motors) const {
+	if (motors.empty()) {
+		throw std::runtime_error("bulk_write: motors can't be empty");
+	}
+	checkUniqueMotors(motors, "bulk_write");
+	if (mRemote) {
+		for (auto const& [id, baseRegister, params] : motors) {
+			noteWrite(id, baseRegister, params);
+		}
+		mRemote->transact({remote::Op::BulkWrite, BroadcastID, 0, 0, {}, {}, {}, motors});
+		return;
+	}
+	auto txBuf = mProtocol->buildBulkWritePackage(motors);
+	for (auto const& [id, baseRegister, params] : motors) {
+		noteWrite(id, baseRegister, params);
+	}
+
+	auto g = std::lock_guard(mMutex);
+	send(BroadcastID, Instruction::BULK_WRITE, txBuf);
+}
+
+void USB2Dynamixel::reg_write(MotorID motor, int baseRegister, Parameter const& txBuf, Timeout timeout) const {
+	reg_write({std::make_tuple(motor, baseRegister, txBuf)}, timeout);
+}
+
+void USB2Dynamixel::reg_write(std::vector<std::tuple<MotorID, int, Parameter>> const& motors, Timeout timeout) const {
+	// every motor can only hold a single staged write
+	checkUniqueMotors(motors, "reg_write");
+	if (mRemote) {
+		for (auto const& [id, baseRegister, params] : motors) {
+			noteStagedWrite(id, baseRegister, params);
+			mRemote->transact({remote::Op::RegWrite, id, baseRegister, 0, timeout, params, {}, {}});
+		}
+		return;
+	}
+	auto levels = learnStatusReturnLevels(motors, timeout);
+	auto g = std::lock_guard(mMutex);
+	stage(motors, levels, timeout);
+}
+
+void USB2Dynamixel::action(MotorID motor) const {
+	if (mRemote) {
+		mRemote->transact({remote::Op::Action, motor, 0, 0, {}, {}, {}, {}});
+	} else {
+		auto g = std::lock_guard(mMutex);
+		send(motor, Instruction::ACTION, {});
+	}
+	noteAction(motor);
+}
+
+void USB2Dynamixel::synchronized_write(std::vector<std::tuple<MotorID, int, Parameter>> const& motors, Timeout timeout) const {
+	if (motors.empty()) {
+		return;
+	}
+	if (mProtocolVersion == Protocol::V2) {
+		// a single packet is always shorter than one REG_WRITE per motor plus the ACTION
+		bulk_write(motors);
+		return;
+	}
+	checkUniqueMotors(motors, "synchronized_write");
+	if (mRemote) {
+		for (auto const& [id, baseRegister, params] : motors) {
+			noteStagedWrite(id, baseRegister, params);
+		}
+		mRemote->transact({remote::Op::SynchronizedWrite, BroadcastID, 0, 0, timeout, {}, {}, motors});
+	} else {
+		auto levels = learnStatusReturnLevels(motors, timeout);
+		// no other request may get between the staged writes and the action
+		auto g = std::lock_guard(mMutex);
+		stage(motors, levels, timeout);
+		send(BroadcastID, Instruction::ACTION, {});
+	}
+	noteAction(BroadcastID);
+}
+
+auto USB2Dynamixel::learnStatusReturnLevels(std::vector<std::tuple<MotorID, int, Parameter>> const& motors, Timeout timeout) const -> std::vector<std::optional<StatusReturnLevel>> {
+	std::vector<std::optional<StatusReturnLevel>> levels;
+	for (auto const& [id, baseRegister, params] : motors) {
+		levels.push_back(statusReturnLevel(id, timeout));
+	}
+	return levels;
+}
+
+void USB2Dynamixel::stage(std::vector<std::tuple<MotorID, int, Parameter>> const& motors, std::vector<std::optional<StatusReturnLevel>> const& levels, Timeout timeout) const {
+	for (std::size_t i{0}; i < motors.size(); ++i) {
+		auto const& [id, baseRegister, params] = motors[i];
+		std::vector<std::byte> parameters;
+		for (auto b : mProtocol->convertAddress(baseRegister)) {
+			parameters.push_back(b);
+		}
+		parameters.insert(parameters.end(), params.begin(), params.end());
+		noteStagedWrite(id, baseRegister, params);
+		send(id, Instruction::REG_WRITE, parameters);
+		// the status packet has to be on the wire before the next packet goes out, the bus is half duplex
+		if (levels[i] == StatusReturnLevel::All) {
+			(void)receive(id, 0, timeout);
+		}
+	}
 }
 
 void USB2Dynamixel::reset(MotorID motor) const {
+	if (mRemote) {
+		mRemote->transact({remote::Op::Reset, motor, 0, 0, {}, {}, {}, {}});
+		return;
+	}
 	auto g = std::lock_guard(mMutex);
-	file_io::write(mPort, mProtocol->createPacket(motor, Instruction::RESET, {}));
+	send(motor, Instruction::RESET, {});
 
 }
 
 void USB2Dynamixel::reboot(MotorID motor) const {
+	if (mRemote) {
+		mRemote->transact({remote::Op::Reboot, motor, 0, 0, {}, {}, {}, {}});
+		return;
+	}
 	auto g = std::lock_guard(mMutex);
-	file_io::write(mPort, mProtocol->createPacket(motor, Instruction::REBOOT, {}));
+	send(motor, Instruction::REBOOT, {});
+}
+
+void USB2Dynamixel::setStatusReturnLevel(MotorID motor, LayoutType layout, StatusReturnLevel level) const {
+	std::optional<int> baseRegister;
+	meta::forAllLayoutTypes([&](auto const& info) {
+		using Info = std::decay_t<decltype(info)>;
+		using Register = typename Info::FullLayout::Type;
+		if (Info::Type == layout) {
+			baseRegister = int(Register::STATUS_RETURN_LEVEL);
+		}
+	});
+	if (not baseRegister) {
+		throw std::runtime_error("unknown layout of motor " + std::to_string(motor));
+	}
+	auto g = std::lock_guard(mStatusReturnMutex);
+	mStatusReturnLevels[motor] = StatusReturnInfo{level, *baseRegister};
+	mUnknownStatusReturnLevels.erase(motor);
+}
+
+auto USB2Dynamixel::getStatusReturnLevel(MotorID motor) const -> std::optional<StatusReturnLevel> {
+	auto g = std::lock_guard(mStatusReturnMutex);
+	auto iter = mStatusReturnLevels.find(motor);
+	if (iter == mStatusReturnLevels.end()) {
+		return std::nullopt;
+	}
+	return iter->second.level;
+}
+
+auto USB2Dynamixel::learnStatusReturnLevel(MotorID motor, LayoutType layout, Timeout timeout) const -> std::optional<StatusReturnLevel> {
+	std::optional<StatusReturnLevel> level;
+	meta::forAllLayoutTypes([&](auto const& info) {
+		using Info = std::decay_t<decltype(info)>;
+		using Register = typename Info::FullLayout::Type;
+		if (Info::Type == layout) {
+			auto [timeoutFlag, motorID, errorCode, rxBuf] = read(motor, int(Register::STATUS_RETURN_LEVEL), 1, timeout);
+			if (not timeoutFlag and motorID == motor and rxBuf.size() == 1) {
+				level = StatusReturnLevel(std::min(uint8_t(rxBuf[0]), uint8_t(StatusReturnLevel::All)));
+			}
+		}
+	});
+	if (level) {
+		setStatusReturnLevel(motor, layout, *level);
+	}
+	return level;
+}
+
+auto USB2Dynamixel::learnStatusReturnLevel(MotorID motor, Timeout timeout) const -> std::optional<StatusReturnLevel> {
+	// the model number is located at the same address for all layouts
+	auto [timeoutFlag, motorID, errorCode, rxBuf] = read(motor, int(mx_v1::Register::MODEL_NUMBER), 2, timeout);
+	if (timeoutFlag or motorID != motor or rxBuf.size() != 2) {
+		return std::nullopt;
+	}
+	auto modelPtr = meta::getMotorInfo(uint16_t(rxBuf[0]) | (uint16_t(rxBuf[1]) << 8));
+	if (not modelPtr) {
+		return std::nullopt;
+	}
+	return learnStatusReturnLevel(motor, modelPtr->layout, timeout);
+}
+
+void USB2Dynamixel::forgetStatusReturnLevel(MotorID motor) const {
+	auto g = std::lock_guard(mStatusReturnMutex);
+	mStatusReturnLevels.erase(motor);
+	mUnknownStatusReturnLevels.erase(motor);
+}
+
+auto USB2Dynamixel::statusReturnLevel(MotorID motor, Timeout timeout) const -> std::optional<StatusReturnLevel> {
+	if (motor == BroadcastID) {
+		return StatusReturnLevel::PingOnly;
+	}
+	{
+		auto g = std::lock_guard(mStatusReturnMutex);
+		if (auto iter = mStatusReturnLevels.find(motor); iter != mStatusReturnLevels.end()) {
+			return iter->second.level;
+		}
+		if (mUnknownStatusReturnLevels.count(motor) > 0) {
+			return std::nullopt;
+		}
+	}
+	auto level = learnStatusReturnLevel(motor, timeout);
+	if (not level) {
+		// don't pay for the probe again on every write, until the motor is detected (or forgotten)
+		auto g = std::lock_guard(mStatusReturnMutex);
+		mUnknownStatusReturnLevels.insert(motor);
+	}
+	return level;
+}
+
+void USB2Dynamixel::noteWrite(MotorID motor, int baseRegister, Parameter const& txBuf) const {
+	auto g = std::lock_guard(mStatusReturnMutex);
+	noteWriteLocked(motor, baseRegister, txBuf);
+}
+
+void USB2Dynamixel::noteStagedWrite(MotorID motor, int baseRegister, Parameter const& txBuf) const {
+	auto g = std::lock_guard(mStatusReturnMutex);
+	mStagedWrites[motor] = std::make_tuple(baseRegister, txBuf);
+}
+
+void USB2Dynamixel::noteAction(MotorID motor) const {
+	auto g = std::lock_guard(mStatusReturnMutex);
+	for (auto iter = mStagedWrites.begin(); iter != mStagedWrites.end();) {
+		auto const& [id, staged] = *iter;
+		if (motor != BroadcastID and id != BroadcastID and id != motor) {
+			++iter;
+			continue;
+		}
+		noteWriteLocked(id, std::get<0>(staged), std::get<1>(staged));
+		iter = mStagedWrites.erase(iter);
+	}
+}
+
+void USB2Dynamixel::noteWriteLocked(MotorID motor, int baseRegister, Parameter const& txBuf) const {
+	for (auto& [id, info] : mStatusReturnLevels) {
+		if (motor != BroadcastID and motor != id) {
+			continue;
+		}
+		int offset = info.baseRegister - baseRegister;
+		if (offset >= 0 and offset < int(txBuf.size())) {
+			info.level = StatusReturnLevel(std::min(uint8_t(txBuf[offset]), uint8_t(StatusReturnLevel::All)));
+		}
+	}
 }
 
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "dynamixel.h"
+#include "BusStatistics.h"
 #include "ProtocolBase.h"
 #include <simplyfile/SerialPort.h>
 
@@ -10,10 +11,13 @@
 #include <map>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <set>
 #include <string>
 
 #include "Layout.h"
+#include "Remote.h"
+#include "TelemetryFrame.h"
 
 #include <iostream>
 
@@ -24,20 +28,69 @@ enum class Protocol : int {
 	V2 = 2,
 };
 
+// value of the STATUS_RETURN_LEVEL register: which instructions a motor answers with a status packet
+enum class StatusReturnLevel : uint8_t {
+	PingOnly = 0,
+	Read     = 1, // ping and read instructions
+	All      = 2,
+};
+
 struct USB2Dynamixel {
 	using Timeout = std::chrono::microseconds;
 
-	USB2Dynamixel(int baudrate, std::string const& device, Protocol protocol = Protocol::V1);
+	// if an "inspexel serve" daemon owns device (and useDaemon is set) all requests are forwarded to it
+	// baudrate and protocol have to match the ones the daemon was started with
+	// otherwise a saved profile of the adapter (see "inspexel tune") is applied
+	USB2Dynamixel(int baudrate, std::string const& device, Protocol protocol = Protocol::V1, bool useDaemon = true);
 	~USB2Dynamixel();
 
 	[[nodiscard]] bool ping(MotorID motor, Timeout timeout) const;
 	[[nodiscard]] auto read(MotorID motor, int baseRegister, size_t length, Timeout timeout) const -> std::tuple<bool, MotorID, ErrorCode, Parameter>;
 	[[nodiscard]] auto bulk_read(std::vector<std::tuple<MotorID, int, size_t>> const& motors, Timeout timeout) const -> std::vector<std::tuple<MotorID, int, ErrorCode, Parameter>>;
 
+	// bulk read the register window of frame from all motors and decode it column wise into frame
+	// frame.motors holds the motors that answered (in order) afterwards
+	void bulk_read(std::vector<MotorID> const& motors, TelemetryFrame& frame, Timeout timeout) const;
+	// same as bulk_read but with a single SYNC_READ (shorter instruction packet), falls back to bulk_read for protocol 1
+	void sync_read(std::vector<MotorID> const& motors, TelemetryFrame& frame, Timeout timeout) const;
+
 	void write(MotorID motor, int baseRegister, Parameter const& txBuf) const;
+	// write and wait for the status packet, returns immediately (without timeout) if the motor is known to not answer writes
+	// if the level of the motor cannot be learned it is waited for the status packet (the failed probe is not repeated)
 	auto writeRead(MotorID motor, int baseRegister, Parameter const& txBuf, Timeout timeout) const -> std::tuple<bool, MotorID, ErrorCode, Parameter>;
+	// write and make sure it was received, either by the status packet or by reading the register back
+	[[nodiscard]] bool writeVerified(MotorID motor, int baseRegister, Parameter const& txBuf, Timeout timeout) const;
 
 	void sync_write(std::map<MotorID, Parameter> const& motorParams, int baseRegister) const;
+	void bulk_write(std::vector<std::tuple<MotorID, int, Parameter>> const& motors) const;
+
+	// stage a write on the motor, it becomes effective with the next action() (a motor holds only one staged write)
+	// the status packet is awaited (up to timeout) if the motor answers writes
+	void reg_write(MotorID motor, int baseRegister, Parameter const& txBuf, Timeout timeout) const;
+	// stage writes of different registers and lengths on many motors
+	void reg_write(std::vector<std::tuple<MotorID, int, Parameter>> const& motors, Timeout timeout) const;
+	// execute all staged writes at once
+	void action(MotorID motor = BroadcastID) const;
+
+	// write registers of many motors so that all writes become effective at the same time
+	// uses a single BULK_WRITE where the protocol supports it, otherwise REG_WRITE per motor followed by one ACTION
+	// (no other request of this instance or of other clients of a daemon gets between them)
+	void synchronized_write(std::vector<std::tuple<MotorID, int, Parameter>> const& motors, Timeout timeout) const;
+
+	// counters and latencies of all transactions this instance put on the bus (empty if requests are forwarded to a daemon)
+	[[nodiscard]] auto getStatistics() const -> BusStatistics const& { return mStatistics; }
+	void resetStatistics() const { mStatistics.reset(); }
+
+	[[nodiscard]] auto getProtocol() const -> Protocol { return mProtocolVersion; }
+	[[nodiscard]] int getBaudrate() const { return mBaudrate; }
+	[[nodiscard]] bool isRemote() const { return mRemote != nullptr; }
+
+	// the status return level of every motor is cached, it is either learned at detection or read lazily
+	void setStatusReturnLevel(MotorID motor, LayoutType layout, StatusReturnLevel level) const;
+	[[nodiscard]] auto getStatusReturnLevel(MotorID motor) const -> std::optional<StatusReturnLevel>;
+	auto learnStatusReturnLevel(MotorID motor, LayoutType layout, Timeout timeout) const -> std::optional<StatusReturnLevel>;
+	auto learnStatusReturnLevel(MotorID motor, Timeout timeout) const -> std::optional<StatusReturnLevel>;
+	void forgetStatusReturnLevel(MotorID motor) const;
 
 	void reset(MotorID motor) const;
 	void reboot(MotorID motor)const;
@@ -83,6 +136,13 @@ struct USB2Dynamixel {
 		write(motor, int(baseRegister), txBuf);
 	}
 
+	template <auto baseRegister, size_t length>
+	void reg_write(MotorID motor, Layout<baseRegister, length> layout, Timeout timeout) const {
+		std::vector<std::byte> txBuf(sizeof(layout));
+		memcpy(txBuf.data(), &layout, sizeof(layout));
+		reg_write(motor, int(baseRegister), txBuf, timeout);
+	}
+
 	template <auto baseRegister, size_t length>
 	[[nodiscard]] auto writeRead(MotorID motor, Layout<baseRegister, length> layout, Timeout timeout) const {
 		std::vector<std::byte> txBuf(sizeof(layout));
@@ -106,9 +166,51 @@ struct USB2Dynamixel {
 	}
 
 private:
+	int      mBaudrate;
+	Protocol mProtocolVersion;
 	std::unique_ptr<ProtocolBase> mProtocol;
+	std::unique_ptr<remote::Client> mRemote;
 	mutable std::mutex mMutex;
 
+	struct StatusReturnInfo {
+		StatusReturnLevel level;
+		int               baseRegister; // address of the STATUS_RETURN_LEVEL register of this motor
+	};
+	mutable std::mutex mStatusReturnMutex;
+	mutable std::map<MotorID, StatusReturnInfo> mStatusReturnLevels;
+	mutable std::set<MotorID> mUnknownStatusReturnLevels; // learning failed (missing motor or unknown model)
+	mutable std::map<MotorID, std::tuple<int, Parameter>> mStagedWrites; // REG_WRITEs waiting for their ACTION
+
+	// the cached status return level, learned on first use, nullopt if that failed (now or before)
+	auto statusReturnLevel(MotorID motor, Timeout timeout) const -> std::optional<StatusReturnLevel>;
+
+	// keep the cached status return levels coherent with writes issued through this instance
+	// staged writes only take effect with their ACTION
+	void noteWrite(MotorID motor, int baseRegister, Parameter const& txBuf) const;
+	void noteStagedWrite(MotorID motor, int baseRegister, Parameter const& txBuf) const;
+	void noteAction(MotorID motor) const;
+	void noteWriteLocked(MotorID motor, int baseRegister, Parameter const& txBuf) const; // mStatusReturnMutex must be held
+
+	// send an instruction packet / receive the status packet of motor for it, both account for the bus statistics (mMutex must be held)
+	void send(MotorID motor, Instruction instruction, Parameter const& parameters) const;
+	auto receive(MotorID motor, std::size_t numParameters, Timeout timeout) const -> std::tuple<bool, MotorID, ErrorCode, Parameter>;
+
+	mutable BusStatistics mStatistics;
+	struct LastInstruction {
+		Instruction                           instruction {Instruction::PING};
+		MotorID                               motor       {BroadcastID};
+		std::chrono::steady_clock::time_point sent;
+	};
+	mutable LastInstruction mLast; // guarded by mMutex
+
+	// the status return level of every motor of motors (learned if it is not cached yet), must be called without mMutex
+	auto learnStatusReturnLevels(std::vector<std::tuple<MotorID, int, Parameter>> const& motors, Timeout timeout) const -> std::vector<std::optional<StatusReturnLevel>>;
+	// REG_WRITE to every motor of motors, waits for the status packet of motors answering writes (mMutex must be held)
+	void stage(std::vector<std::tuple<MotorID, int, Parameter>> const& motors, std::vector<std::optional<StatusReturnLevel>> const& levels, Timeout timeout) const;
+
+	// receive the status packets of a bulk or sync read into frame (mMutex must be held), returns the number of motors that answered
+	auto receiveFrame(std::vector<MotorID> const& motors, TelemetryFrame& frame, Timeout timeout) const -> std::size_t;
+
 	simplyfile::SerialPort mPort;
 };
 
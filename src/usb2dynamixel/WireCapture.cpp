@@ -0,0 +1,191 @@
+#include "WireCapture.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace dynamixel::capture {
+namespace {
+
+auto monotonicNow() -> int64_t {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+auto nextPowerOfTwo(std::size_t size) -> std::size_t {
+	std::size_t p {1};
+	while (p < size) {
+		p <<= 1;
+	}
+	return p;
+}
+
+void writeAll(int fd, std::byte const* data, std::size_t size) {
+	std::size_t written {0};
+	while (written < size) {
+		auto n = ::write(fd, data + written, size - written);
+		if (n < 0 and errno == EINTR) {
+			continue;
+		}
+		if (n <= 0) {
+			throw std::runtime_error("cannot write capture: " + std::string(strerror(errno)));
+		}
+		written += n;
+	}
+}
+
+}
+
+Writer::Writer(std::string const& path, int baudrate, int protocol, std::size_t ringSize, std::chrono::milliseconds flushInterval)
+	: mRing(nextPowerOfTwo(std::max<std::size_t>(ringSize, 1<<16)))
+	, mMask(mRing.size() - 1)
+	, mFlushInterval(flushInterval)
+{
+	mFD = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (mFD < 0) {
+		throw std::runtime_error("cannot create capture " + path + ": " + strerror(errno));
+	}
+	auto header = FileHeader{Magic, Version,
+		std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count(), monotonicNow(),
+		uint32_t(baudrate), uint8_t(protocol), {}};
+	try {
+		writeAll(mFD, reinterpret_cast<std::byte const*>(&header), sizeof(header));
+	} catch (...) {
+		::close(mFD);
+		throw;
+	}
+	mFlusher = std::thread([this] { flushLoop(); });
+}
+
+Writer::~Writer() {
+	mStop = true;
+	mFlusher.join();
+	if (mPendingLost > 0 and mError.empty()) {
+		// nothing followed the dropped records, a record without data carries their count
+		auto header = RecordHeader{monotonicNow(), mPendingLost, 0, 0, 0};
+		try {
+			writeAll(mFD, reinterpret_cast<std::byte const*>(&header), sizeof(header));
+		} catch (std::exception const& e) {
+			mError = e.what();
+		}
+	}
+	::close(mFD);
+	if (not mError.empty()) {
+		std::cout << mError << "\n";
+	}
+	if (auto lost = getLost(); lost > 0) {
+		std::cout << "capture: " << lost << " records were dropped, the ring was full\n";
+	}
+}
+
+void Writer::record(Direction direction, std::byte const* data, std::size_t size) noexcept {
+	while (size > 0) {
+		auto chunk  = std::min<std::size_t>(size, 0xffff);
+		auto needed = sizeof(RecordHeader) + chunk;
+		auto head   = mHead.load(std::memory_order_relaxed);
+		auto tail   = mTail.load(std::memory_order_acquire);
+		if (needed > mRing.size() - (head - tail)) {
+			++mPendingLost;
+			mLostTotal.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		auto header = RecordHeader{monotonicNow(), mPendingLost, uint16_t(chunk), uint8_t(direction), 0};
+		push(&header, sizeof(header), head);
+		push(data, chunk, head + sizeof(header));
+		mHead.store(head + needed, std::memory_order_release);
+		mPendingLost = 0;
+		data += chunk;
+		size -= chunk;
+	}
+}
+
+void Writer::push(void const* data, std::size_t size, uint64_t head) noexcept {
+	auto offset = head & mMask;
+	auto first  = std::min(size, mRing.size() - offset);
+	std::memcpy(mRing.data() + offset, data, first);
+	std::memcpy(mRing.data(), static_cast<std::byte const*>(data) + first, size - first);
+}
+
+void Writer::drain() {
+	auto head = mHead.load(std::memory_order_acquire);
+	auto tail = mTail.load(std::memory_order_relaxed);
+	while (tail < head) {
+		auto offset = tail & mMask;
+		auto size   = std::min<uint64_t>(head - tail, mRing.size() - offset);
+		if (mError.empty()) {
+			try {
+				writeAll(mFD, mRing.data() + offset, size);
+			} catch (std::exception const& e) {
+				// keep draining the ring so record() does not count everything as lost
+				mError = e.what();
+			}
+		}
+		tail += size;
+		mTail.store(tail, std::memory_order_release);
+	}
+}
+
+void Writer::flushLoop() {
+	while (true) {
+		bool stopping = mStop;
+		drain();
+		if (stopping) {
+			return;
+		}
+		std::this_thread::sleep_for(mFlushInterval);
+	}
+}
+
+auto read(std::string const& path) -> Capture {
+	int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		throw std::runtime_error("cannot open capture " + path + ": " + strerror(errno));
+	}
+	std::vector<std::byte> content;
+	std::byte chunk[1<<16];
+	ssize_t n;
+	while ((n = ::read(fd, chunk, sizeof(chunk))) != 0) {
+		if (n < 0 and errno == EINTR) {
+			continue;
+		}
+		if (n < 0) {
+			::close(fd);
+			throw std::runtime_error("cannot read capture " + path + ": " + strerror(errno));
+		}
+		content.insert(content.end(), chunk, chunk + n);
+	}
+	::close(fd);
+
+	Capture capture;
+	if (content.size() < sizeof(FileHeader)) {
+		throw std::runtime_error(path + " is not a capture");
+	}
+	std::memcpy(&capture.header, content.data(), sizeof(FileHeader));
+	if (capture.header.magic != Magic or capture.header.version != Version) {
+		throw std::runtime_error(path + " is not a capture (or of an unsupported version)");
+	}
+	std::size_t pos = sizeof(FileHeader);
+	while (pos < content.size()) {
+		RecordHeader header;
+		if (content.size() - pos < sizeof(header)) {
+			capture.truncated = true;
+			break;
+		}
+		std::memcpy(&header, content.data() + pos, sizeof(header));
+		pos += sizeof(header);
+		if (content.size() - pos < header.length) {
+			capture.truncated = true;
+			break;
+		}
+		auto data = content.begin() + pos;
+		capture.records.push_back(Record{std::chrono::nanoseconds{header.timestamp}, header.lost, Direction(header.direction), Parameter(data, data + header.length)});
+		pos += header.length;
+	}
+	return capture;
+}
+
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "dynamixel.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * capture of the raw bytes sent to and received from the bus
+ *
+ * file layout (all integers little endian):
+ *   FileHeader
+ *   records: RecordHeader, length bytes as they were read or written
+ *
+ * a record is one read() or write() of the port (split if longer than 65535 bytes),
+ * records are in the order of their CLOCK_MONOTONIC timestamps; RecordHeader::lost counts the records
+ * that were dropped before this one because the ring was full (a final record of length 0 may only carry that count).
+ */
+namespace dynamixel::capture {
+
+constexpr uint32_t Magic   = 0x50414358; // "XCAP"
+constexpr uint32_t Version = 1;
+
+enum class Direction : uint8_t {
+	Tx = 0,
+	Rx = 1,
+};
+
+#pragma pack(push, 1)
+struct FileHeader {
+	uint32_t magic;
+	uint32_t version;
+	int64_t  startRealtime;  // ns since the unix epoch when the capture was started
+	int64_t  startMonotonic; // CLOCK_MONOTONIC at the same moment
+	uint32_t baudrate;
+	uint8_t  protocol;
+	uint8_t  padding[3];
+};
+
+struct RecordHeader {
+	int64_t  timestamp; // ns, CLOCK_MONOTONIC
+	uint32_t lost;
+	uint16_t length;
+	uint8_t  direction;
+	uint8_t  padding;
+};
+#pragma pack(pop)
+
+/**
+ * records go into a lock free ring in memory and are written to the file by a background thread
+ * record() never blocks and makes no syscalls, if the ring is full the record is dropped (and counted)
+ * record() must not be called concurrently (all I/O of a port is serialized by USB2Dynamixel anyway)
+ */
+struct Writer {
+	// creates (truncates) path, ringSize is rounded up to a power of two
+	Writer(std::string const& path, int baudrate, int protocol, std::size_t ringSize = 1<<22, std::chrono::milliseconds flushInterval = std::chrono::milliseconds{50});
+	// writes everything that is still in the ring
+	~Writer();
+
+	Writer(Writer const&) = delete;
+	Writer& operator=(Writer const&) = delete;
+
+	void record(Direction direction, std::byte const* data, std::size_t size) noexcept;
+
+	[[nodiscard]] auto getLost() const -> uint64_t { return mLostTotal.load(std::memory_order_relaxed); }
+
+private:
+	void push(void const* data, std::size_t size, uint64_t head) noexcept;
+	void drain();
+	void flushLoop();
+
+	int                       mFD {-1};
+	std::vector<std::byte>    mRing;
+	uint64_t                  mMask;
+	std::atomic<uint64_t>     mHead {0};       // written by record()
+	std::atomic<uint64_t>     mTail {0};       // written by the flush thread
+	uint32_t                  mPendingLost {0}; // records dropped since the last stored one (producer only)
+	std::atomic<uint64_t>     mLostTotal {0};
+	std::chrono::milliseconds mFlushInterval;
+	std::string               mError;
+	std::atomic<bool>         mStop {false};
+	std::thread               mFlusher;
+};
+
+struct Record {
+	std::chrono::nanoseconds timestamp;
+	uint32_t                 lost;
+	Direction                direction;
+	Parameter                data;
+};
+
+struct Capture {
+	FileHeader          header;
+	std::vector<Record> records;
+	bool                truncated {false}; // the last record was cut off (e.g. the writer crashed)
+};
+
+[[nodiscard]] auto read(std::string const& path) -> Capture;
+
+}
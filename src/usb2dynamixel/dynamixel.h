@@ -3,6 +3,7 @@
 #include <cstdint>
 #include <functional>
 #include <stdexcept>
+#include <string>
 #include <vector>
 
 namespace dynamixel {
@@ -30,6 +31,24 @@ namespace dynamixel {
 		BULK_WRITE = 0x93,
 	};
 
+	inline auto to_string(Instruction instruction) -> std::string {
+		switch (instruction) {
+		case Instruction::PING:       return "ping";
+		case Instruction::READ:       return "read";
+		case Instruction::WRITE:      return "write";
+		case Instruction::REG_WRITE:  return "reg_write";
+		case Instruction::ACTION:     return "action";
+		case Instruction::RESET:      return "reset";
+		case Instruction::REBOOT:     return "reboot";
+		case Instruction::STATUS:     return "status";
+		case Instruction::SYNC_READ:  return "sync_read";
+		case Instruction::SYNC_WRITE: return "sync_write";
+		case Instruction::BULK_READ:  return "bulk_read";
+		case Instruction::BULK_WRITE: return "bulk_write";
+		}
+		return std::to_string(int(instruction));
+	}
+
 	inline uint32_t baudIndexToBaudrate(uint8_t baudIdx) {
 		if (baudIdx < 250) {
 			return (2000000 / (baudIdx + 1));
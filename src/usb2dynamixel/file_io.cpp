@@ -1,5 +1,7 @@
 #include "file_io.h"
+#include "WireCapture.h"
 
+#include <atomic>
 #include <cerrno>
 #include <cstring>
 #include <array>
@@ -9,6 +11,34 @@
 
 
 namespace dynamixel::file_io {
+namespace {
+
+std::atomic<capture::Writer*> activeCapture {nullptr};
+std::atomic<int>              capturedFD {-1};
+
+// costs a single relaxed load while nothing is captured
+void record(int _fd, capture::Direction direction, std::byte const* data, std::size_t size) {
+	if (_fd != capturedFD.load(std::memory_order_relaxed) or size == 0) {
+		return;
+	}
+	if (auto capture = activeCapture.load(std::memory_order_acquire)) {
+		capture->record(direction, data, size);
+	}
+}
+
+}
+
+void setCapture(capture::Writer* capture) {
+	activeCapture = capture;
+}
+
+void setCapturedFD(int _fd) {
+	capturedFD = _fd;
+}
+
+void releaseCapturedFD(int _fd) {
+	capturedFD.compare_exchange_strong(_fd, -1);
+}
 
 auto read(int _fd, size_t maxReadBytes) -> std::vector<std::byte> {
 	std::vector<std::byte> rxBuf(maxReadBytes);
@@ -28,21 +58,23 @@ auto read(int _fd, size_t maxReadBytes) -> std::vector<std::byte> {
 		bytesRead += r;
 	} while (bytesRead < maxReadBytes);
 	rxBuf.resize(bytesRead);
+	record(_fd, capture::Direction::Rx, rxBuf.data(), rxBuf.size());
 	return rxBuf;
 }
 
 size_t flushRead(int _fd) {
 	size_t bytesRead {0};
-	std::array<uint8_t, 4096> dummy;
-	ssize_t r {1};
-	while (r != -1 and r != 0) {
+	std::array<std::byte, 4096> dummy;
+	ssize_t r;
+	while ((r = ::read(_fd, dummy.data(), dummy.size())) > 0) { // read flush
+		record(_fd, capture::Direction::Rx, dummy.data(), r);
 		bytesRead += r;
-		r = ::read(_fd, dummy.data(), dummy.size()); // read flush
 	}
 	return bytesRead;
 }
 
 void write(int _fd, std::vector<std::byte> const& txBuf) {
+	record(_fd, capture::Direction::Tx, txBuf.data(), txBuf.size());
 	uint32_t bytesWritten = 0;
 	const size_t count = txBuf.size();
 	do {
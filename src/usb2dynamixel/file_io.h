@@ -3,8 +3,19 @@
 #include <vector>
 #include <cstddef>
 
+namespace dynamixel::capture {
+struct Writer;
+}
+
 namespace dynamixel::file_io {
 auto read(int _fd, size_t maxReadBytes) -> std::vector<std::byte>;
 size_t flushRead(int _fd);
 void write(int _fd, std::vector<std::byte> const& txBuf);
-}
\ No newline at end of file
+
+// everything read from or written to the captured fd is recorded into the capture (nullptr disables capturing)
+// the capture must outlive all I/O, only a single fd is captured at a time
+void setCapture(capture::Writer* capture);
+void setCapturedFD(int _fd);
+// stops capturing _fd (if it is the captured one)
+void releaseCapturedFD(int _fd);
+}